@@ -0,0 +1,175 @@
+#include "app-instrument.h"
+
+#ifdef APP_INSTRUMENT
+
+/** Size of a cache line in bytes. */
+#define app_cache_line_c 64
+
+/** Counters of one thread. Only the owning thread writes them, with relaxed
+atomic stores so app_instr_snapshot() may read them at any time. */
+typedef struct app_instr_slot_tag
+{
+    app_instr_fn_stats_t fn[app_instr_fn_count_c];
+    uint64_t fail[app_instr_fail_count_c];
+    /** Next slot of the list of all slots. */
+    struct app_instr_slot_tag * next;
+} app_instr_slot_t;
+
+/** Names of the functions, in the order of app_instr_fn_t. */
+static const char * const mFnNames[app_instr_fn_count_c] =
+{
+    "calc_upper_layer_chksum",
+    "app_pton",
+    "app_pton_ipv6",
+    "app_ntop",
+    "app_ntop_format"
+};
+
+/** Names of the failures, in the order of app_instr_fail_t. */
+static const char * const mFailNames[app_instr_fail_count_c] =
+{
+    "pton_short",
+    "pton_colon",
+    "pton_syntax",
+    "ntop_bits",
+    "ntop_size"
+};
+
+/** All slots ever created. Slots are never freed, so counts of threads that
+have exited stay in the snapshots. */
+static _Atomic(app_instr_slot_t *) mSlots;
+
+/** Slot of the calling thread. */
+static _Thread_local app_instr_slot_t * mSlot;
+
+/**
+Count a call of an instrumented function.
+@param[in] fn The function.
+@param[in] bytes Number of bytes processed by the call.
+@param[in] cycles Latency of the call in cycles.
+*/
+void app_instr_record(app_instr_fn_t fn, uint64_t bytes, uint64_t cycles)
+{
+    app_instr_fn_stats_t * s;
+    uint8_t bucket;
+
+    if ((NULL == mSlot) && (NULL == app_instr_slot()))
+    {
+        return;
+    }
+    s = &mSlot->fn[fn];
+
+    bucket = (uint8_t) (63 - __builtin_clzll(cycles | 1));
+    if (bucket >= app_instr_buckets_c)
+    {
+        bucket = app_instr_buckets_c - 1;
+    }
+
+    app_instr_add(&s->calls, 1);
+    app_instr_add(&s->bytes, bytes);
+    app_instr_add(&s->cycles, cycles);
+    app_instr_add(&s->hist[bucket], 1);
+}
+
+/**
+Count a failure.
+@param[in] reason The reason of the failure.
+*/
+void app_instr_fail(app_instr_fail_t reason)
+{
+    if ((NULL != mSlot) || (NULL != app_instr_slot()))
+    {
+        app_instr_add(&mSlot->fail[reason], 1);
+    }
+}
+
+/**
+Merge the counters of all threads. Counters of running threads may advance
+while they are read, so the result is consistent per counter only.
+@param[out] stats The merged counters.
+*/
+void app_instr_snapshot(app_instr_stats_t * stats)
+{
+    const app_instr_slot_t * slot;
+    const uint64_t * src;
+    uint64_t * dst;
+    size_t words;
+    size_t i;
+
+    memset(stats, 0, sizeof(*stats));
+
+    slot = atomic_load_explicit(&mSlots, memory_order_acquire);
+    for (; NULL != slot; slot = slot->next)
+    {
+        /* Both structures start with the same counters. */
+        src = (const uint64_t *) slot;
+        dst = (uint64_t *) stats;
+        words = (sizeof(slot->fn) + sizeof(slot->fail)) / sizeof(uint64_t);
+        for (i = 0; i < words; ++i)
+        {
+            dst[i] += __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+        }
+        ++stats->threads;
+    }
+}
+
+/**
+Name of an instrumented function.
+@param[in] fn The function.
+@return The name.
+*/
+const char * app_instr_fn_name(app_instr_fn_t fn)
+{
+    return (fn < app_instr_fn_count_c) ? mFnNames[fn] : "";
+}
+
+/**
+Name of a failure reason.
+@param[in] reason The reason.
+@return The name.
+*/
+const char * app_instr_fail_name(app_instr_fail_t reason)
+{
+    return (reason < app_instr_fail_count_c) ? mFailNames[reason] : "";
+}
+
+/**
+Create the slot of the calling thread and publish it.
+@return The slot or NULL when out of memory.
+*/
+static app_instr_slot_t * app_instr_slot(void)
+{
+    app_instr_slot_t * slot;
+    size_t size;
+
+    size = (sizeof(app_instr_slot_t) + app_cache_line_c - 1) &
+           ~(size_t) (app_cache_line_c - 1);
+    slot = aligned_alloc(app_cache_line_c, size);
+    if (NULL != slot)
+    {
+        memset(slot, 0, size);
+        slot->next = atomic_load_explicit(&mSlots, memory_order_relaxed);
+        while (!atomic_compare_exchange_weak_explicit(&mSlots, &slot->next,
+                                                      slot,
+                                                      memory_order_release,
+                                                      memory_order_relaxed))
+        {
+        }
+        mSlot = slot;
+    }
+
+    return slot;
+}
+
+/**
+Add to a counter of the calling thread. A plain add, only this thread
+writes the counter; the atomic store keeps concurrent snapshots defined.
+@param[in,out] counter The counter.
+@param[in] val The value to add.
+*/
+static inline void app_instr_add(uint64_t * counter, uint64_t val)
+{
+    __atomic_store_n(counter, *counter + val, __ATOMIC_RELAXED);
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,107 @@
+#ifndef APP_INSTRUMENT_H
+#define APP_INSTRUMENT_H
+
+/**
+Optional instrumentation of the hot paths, enabled by defining APP_INSTRUMENT
+at build time. Each thread counts calls, bytes and cycle latency histograms
+per function, plus failures per reason, in its own cache line aligned slot.
+app_instr_snapshot() merges the slots of all threads. Without APP_INSTRUMENT
+the macros expand to nothing and app-instrument.c is empty.
+*/
+
+/** Instrumented functions. */
+typedef enum app_instr_fn_tag
+{
+    app_instr_upper_layer_chksum_c = 0,
+    app_instr_pton_c,
+    app_instr_pton_ipv6_c,
+    app_instr_ntop_c,
+    app_instr_ntop_format_c,
+    app_instr_fn_count_c
+} app_instr_fn_t;
+
+/** Failure reasons. */
+typedef enum app_instr_fail_tag
+{
+    /** app_pton(): fewer than two characters. */
+    app_instr_fail_pton_short_c = 0,
+    /** app_pton(): leading ':' not followed by another ':'. */
+    app_instr_fail_pton_colon_c,
+    /** app_pton(): app_pton_ipv6() returned bits = 0. */
+    app_instr_fail_pton_syntax_c,
+    /** app_ntop(): more than 128 bits. */
+    app_instr_fail_ntop_bits_c,
+    /** app_ntop(): destination buffer too small. */
+    app_instr_fail_ntop_size_c,
+    app_instr_fail_count_c
+} app_instr_fail_t;
+
+/** Number of latency buckets, bucket i counts latencies in [2^i, 2^(i+1))
+cycles, the last one everything above. */
+#define app_instr_buckets_c 32
+
+/** Counters of one function. */
+typedef struct app_instr_fn_stats_tag
+{
+    /** Number of calls. */
+    uint64_t calls;
+    /** Bytes processed. */
+    uint64_t bytes;
+    /** Total cycles spent. */
+    uint64_t cycles;
+    /** Latency histogram in cycles. */
+    uint64_t hist[app_instr_buckets_c];
+} app_instr_fn_stats_t;
+
+/** Counters of all functions, as returned by app_instr_snapshot(). */
+typedef struct app_instr_stats_tag
+{
+    app_instr_fn_stats_t fn[app_instr_fn_count_c];
+    uint64_t fail[app_instr_fail_count_c];
+    /** Number of threads merged. */
+    uint32_t threads;
+} app_instr_stats_t;
+
+#ifdef APP_INSTRUMENT
+
+void app_instr_record(app_instr_fn_t fn, uint64_t bytes, uint64_t cycles);
+void app_instr_fail(app_instr_fail_t reason);
+void app_instr_snapshot(app_instr_stats_t * stats);
+const char * app_instr_fn_name(app_instr_fn_t fn);
+const char * app_instr_fail_name(app_instr_fail_t reason);
+
+/**
+Read the cycle counter, or the monotonic clock in ns where there is none.
+@return The current count.
+*/
+static inline uint64_t app_instr_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+}
+
+/** Start timing the enclosing function. */
+#define APP_INSTR_BEGIN() \
+    uint64_t app_instr_t0 = app_instr_cycles()
+/** Count a call of fn that processed bytes, timed from APP_INSTR_BEGIN(). */
+#define APP_INSTR_END(fn, bytes) \
+    app_instr_record((fn), (bytes), app_instr_cycles() - app_instr_t0)
+/** Count a failure. */
+#define APP_INSTR_FAIL(reason) \
+    app_instr_fail(reason)
+
+#else
+
+#define APP_INSTR_BEGIN()
+#define APP_INSTR_END(fn, bytes) ((void) 0)
+#define APP_INSTR_FAIL(reason) ((void) 0)
+
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,353 @@
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+/** AVX2 kernels are built and used when the CPU has AVX2. */
+#define APP_BASE64_AVX2 1
+#endif
+
+/** Base64 alphabets of rfc 4648. */
+typedef enum app_base64_tag
+{
+    /** Section 4, "+/" and '=' padding. */
+    app_base64_std_c = 0,
+    /** Section 5, "-_", URL and file name safe, no padding. */
+    app_base64_url_c
+} app_base64_t;
+
+/** Digits for base64, per alphabet */
+static const char mB64Digits[2][65] =
+{
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/",
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_"
+};
+
+/**
+Encode a binary array to a base64 ASCII array.
+@param[out] ascii A pointer to an array stored the output ASCII data. The
+memory is allocated by caller, its size is returned when ascii is NULL.
+@param[in] bin A pointer to the binary array.
+@param[in] len The length of the binary array in bytes.
+@param[in] variant The alphabet. app_base64_std_c output is padded with '='
+to a multiple of 4, app_base64_url_c output is not padded.
+@return The length of the encoded "ascii" array. When parameter "ascii" is
+NULL, the memory size requested by the encoded "ascii" array is returned.
+*/
+size_t app_bin_to_base64(uint8_t * ascii, const uint8_t * bin, size_t len,
+                         app_base64_t variant)
+{
+    const char * digits = mB64Digits[variant & 0x01];
+    size_t out_len;
+    size_t i = 0;
+    size_t o = 0;
+    uint32_t v;
+
+    if (app_base64_std_c == variant)
+    {
+        out_len = (len + 2) / 3 * 4;
+    }
+    else
+    {
+        out_len = len / 3 * 4 + ((0 != len % 3) ? (len % 3) + 1 : 0);
+    }
+
+    if (bin != NULL)
+    {
+        if (ascii != NULL)
+        {
+#ifdef APP_BASE64_AVX2
+            if (__builtin_cpu_supports("avx2"))
+            {
+                i = app_base64_encode_avx2(ascii, bin, len, variant);
+                o = i / 3 * 4;
+            }
+#endif
+            for (; i + 3 <= len; i += 3, o += 4)
+            {
+                v = (bin[i] << 16) | (bin[i + 1] << 8) | bin[i + 2];
+                ascii[o] = digits[(v >> 18) & 0x3F];
+                ascii[o + 1] = digits[(v >> 12) & 0x3F];
+                ascii[o + 2] = digits[(v >> 6) & 0x3F];
+                ascii[o + 3] = digits[v & 0x3F];
+            }
+
+            if (i < len)
+            {
+                v = bin[i] << 16;
+                if (i + 1 < len)
+                {
+                    v |= bin[i + 1] << 8;
+                }
+                ascii[o] = digits[(v >> 18) & 0x3F];
+                ascii[o + 1] = digits[(v >> 12) & 0x3F];
+                o += 2;
+                if (i + 1 < len)
+                {
+                    ascii[o] = digits[(v >> 6) & 0x3F];
+                    ++o;
+                }
+                while (o < out_len)
+                {
+                    ascii[o] = '=';
+                    ++o;
+                }
+            }
+        }
+    }
+
+    return out_len;
+}
+
+/**
+Decode a base64 ASCII array to a binary array.
+@param[out] bin A pointer to the decoded binary array. The memory should be
+allocated outside, its size is returned when bin is NULL.
+@param[in] ascii A pointer to the base64 ASCII array. '=' padding is accepted
+but not required for both alphabets. A last group of 2 or 3 digits decodes to
+1 or 2 bytes.
+@param[in] len The length of the input ASCII array in bytes.
+@param[in] variant The alphabet.
+@param[out] endptr The position to the first byte that not used in the
+conversion, i.e. the first invalid byte or ascii + len.
+@return The length of the decoded "bin" array. When parameter "bin" is NULL,
+the memory size requested by the decoded "bin" array is returned.
+*/
+size_t app_base64_to_bin(uint8_t * bin, const uint8_t * ascii, size_t len,
+                         app_base64_t variant, const uint8_t ** endptr)
+{
+    int8_t d[4];
+    size_t i = 0;
+    size_t o = 0;
+    uint8_t n;
+
+    *endptr = ascii;
+    if (NULL == ascii)
+    {
+        return 0;
+    }
+
+#ifdef APP_BASE64_AVX2
+    if ((NULL != bin) && __builtin_cpu_supports("avx2"))
+    {
+        i = app_base64_decode_avx2(bin, ascii, len, variant);
+        o = i / 4 * 3;
+    }
+#endif
+
+    while (i < len)
+    {
+        /* Collect up to 4 digits, stop at the first invalid one. */
+        for (n = 0; (n < 4) && (i + n < len); ++n)
+        {
+            d[n] = app_base64_value(ascii[i + n], variant);
+            if (d[n] < 0)
+            {
+                break;
+            }
+        }
+
+        if (n >= 2)
+        {
+            if (NULL != bin)
+            {
+                bin[o] = (uint8_t)((d[0] << 2) | (d[1] >> 4));
+                if (n >= 3)
+                {
+                    bin[o + 1] = (uint8_t)((d[1] << 4) | (d[2] >> 2));
+                }
+                if (n == 4)
+                {
+                    bin[o + 2] = (uint8_t)((d[2] << 6) | d[3]);
+                }
+            }
+            o += n - 1;
+            i += n;
+        }
+
+        if (n < 4)
+        {
+            /* End of the data: skip the padding of the last group. */
+            if ((n >= 2) && (i < len) && ('=' == ascii[i]))
+            {
+                ++i;
+                if ((n == 2) && (i < len) && ('=' == ascii[i]))
+                {
+                    ++i;
+                }
+            }
+            break;
+        }
+    }
+
+    *endptr = ascii + i;
+    return o;
+}
+
+/**
+Value of a base64 digit.
+@param[in] ch The character.
+@param[in] variant The alphabet.
+@return The value in [0, 63] or -1 when ch is not a digit of the alphabet.
+*/
+static int8_t app_base64_value(uint8_t ch, app_base64_t variant)
+{
+    int8_t val = -1;
+
+    if ((ch >= 'A') && (ch <= 'Z'))
+    {
+        val = ch - 'A';
+    }
+    else if ((ch >= 'a') && (ch <= 'z'))
+    {
+        val = ch - 'a' + 26;
+    }
+    else if ((ch >= '0') && (ch <= '9'))
+    {
+        val = ch - '0' + 52;
+    }
+    else if (ch == (uint8_t)mB64Digits[variant & 0x01][62])
+    {
+        val = 62;
+    }
+    else if (ch == (uint8_t)mB64Digits[variant & 0x01][63])
+    {
+        val = 63;
+    }
+
+    return val;
+}
+
+#ifdef APP_BASE64_AVX2
+/**
+Encode 24 bytes to 32 digits per iteration, see W. Mula and D. Lemire,
+"Faster Base64 Encoding and Decoding Using AVX2 Instructions".
+@param[out] ascii The output ASCII array.
+@param[in] bin The binary array.
+@param[in] len The length of the binary array in bytes.
+@param[in] variant The alphabet.
+@return The number of bytes encoded, a multiple of 3. The caller encodes the
+rest.
+*/
+__attribute__((target("avx2")))
+static size_t app_base64_encode_avx2(uint8_t * ascii, const uint8_t * bin,
+                                     size_t len, app_base64_t variant)
+{
+    /* Offsets from a 6-bit value to its digit, indexed as computed below. */
+    const __m256i lut = (app_base64_std_c == variant) ?
+        _mm256_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4,
+                         -19, -16, 0, 0,
+                         65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4,
+                         -19, -16, 0, 0) :
+        _mm256_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4,
+                         -17, 32, 0, 0,
+                         65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4,
+                         -17, 32, 0, 0);
+    const __m256i shuf = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4,
+                                          7, 6, 8, 7, 10, 9, 11, 10,
+                                          1, 0, 2, 1, 4, 3, 5, 4,
+                                          7, 6, 8, 7, 10, 9, 11, 10);
+    __m256i in;
+    __m256i t0;
+    __m256i t1;
+    __m256i idx;
+    size_t i = 0;
+
+    /* The upper lane reads 16 bytes from i + 12. */
+    for (; i + 28 <= len; i += 24, ascii += 32)
+    {
+        in = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(
+                _mm_loadu_si128((const __m128i *)(bin + i))),
+            _mm_loadu_si128((const __m128i *)(bin + i + 12)), 1);
+
+        /* Spread every 3 bytes to 4 bytes holding 6 bits each. */
+        in = _mm256_shuffle_epi8(in, shuf);
+        t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+        t0 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        t1 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+        t1 = _mm256_mullo_epi16(t1, _mm256_set1_epi32(0x01000010));
+        in = _mm256_or_si256(t0, t1);
+
+        /* 0..25 -> 0, 26..51 -> 1, 52..61 -> 2..11, 62 -> 12, 63 -> 13. */
+        idx = _mm256_subs_epu8(in, _mm256_set1_epi8(51));
+        idx = _mm256_sub_epi8(idx,
+                              _mm256_cmpgt_epi8(in, _mm256_set1_epi8(25)));
+        in = _mm256_add_epi8(in, _mm256_shuffle_epi8(lut, idx));
+
+        _mm256_storeu_si256((__m256i *)ascii, in);
+    }
+
+    return i;
+}
+
+/**
+Decode 32 digits to 24 bytes per iteration. A block holding anything but
+digits of the alphabet, padding included, is left to the caller.
+@param[out] bin The output binary array.
+@param[in] ascii The base64 ASCII array.
+@param[in] len The length of the ASCII array in bytes.
+@param[in] variant The alphabet.
+@return The number of digits decoded, a multiple of 32.
+*/
+__attribute__((target("avx2")))
+static size_t app_base64_decode_avx2(uint8_t * bin, const uint8_t * ascii,
+                                     size_t len, app_base64_t variant)
+{
+    const __m256i c62 = _mm256_set1_epi8(mB64Digits[variant & 0x01][62]);
+    const __m256i c63 = _mm256_set1_epi8(mB64Digits[variant & 0x01][63]);
+    const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9,
+                                          8, 14, 13, 12, -1, -1, -1, -1,
+                                          2, 1, 0, 6, 5, 4, 10, 9,
+                                          8, 14, 13, 12, -1, -1, -1, -1);
+    const __m256i store = _mm256_setr_epi32(-1, -1, -1, -1, -1, -1, 0, 0);
+    __m256i in;
+    __m256i m;
+    __m256i val;
+    __m256i ok;
+    size_t i = 0;
+
+    for (; i + 32 <= len; i += 32, bin += 24)
+    {
+        in = _mm256_loadu_si256((const __m256i *)(ascii + i));
+
+        /* Bytes above 0x7F are negative and fall in no range. */
+        m = _mm256_and_si256(_mm256_cmpgt_epi8(in, _mm256_set1_epi8('A' - 1)),
+                             _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), in));
+        ok = m;
+        val = _mm256_and_si256(m, _mm256_sub_epi8(in, _mm256_set1_epi8('A')));
+
+        m = _mm256_and_si256(_mm256_cmpgt_epi8(in, _mm256_set1_epi8('a' - 1)),
+                             _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), in));
+        ok = _mm256_or_si256(ok, m);
+        val = _mm256_or_si256(val, _mm256_and_si256(m,
+                  _mm256_sub_epi8(in, _mm256_set1_epi8('a' - 26))));
+
+        m = _mm256_and_si256(_mm256_cmpgt_epi8(in, _mm256_set1_epi8('0' - 1)),
+                             _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), in));
+        ok = _mm256_or_si256(ok, m);
+        val = _mm256_or_si256(val, _mm256_and_si256(m,
+                  _mm256_add_epi8(in, _mm256_set1_epi8(52 - '0'))));
+
+        m = _mm256_cmpeq_epi8(in, c62);
+        ok = _mm256_or_si256(ok, m);
+        val = _mm256_or_si256(val, _mm256_and_si256(m, _mm256_set1_epi8(62)));
+
+        m = _mm256_cmpeq_epi8(in, c63);
+        ok = _mm256_or_si256(ok, m);
+        val = _mm256_or_si256(val, _mm256_and_si256(m, _mm256_set1_epi8(63)));
+
+        if (-1 != _mm256_movemask_epi8(ok))
+        {
+            break;
+        }
+
+        /* Merge 4 x 6 bits to 24 bits per 32-bit word, then drop the gaps. */
+        val = _mm256_maddubs_epi16(val, _mm256_set1_epi32(0x01400140));
+        val = _mm256_madd_epi16(val, _mm256_set1_epi32(0x00011000));
+        val = _mm256_shuffle_epi8(val, pack);
+        val = _mm256_permutevar8x32_epi32(val,
+                  _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+        _mm256_maskstore_epi32((int *)bin, store, val);
+    }
+
+    return i;
+}
+#endif
\ No newline at end of file
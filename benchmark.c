@@ -0,0 +1,1208 @@
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+Micro-benchmarks of the utilities, without any network access.
+Every case is calibrated to run for about bench_target_ns_c, repeated
+bench_repeat_c times and the fastest run is reported, as ns/op, GB/s and
+cycles/byte. Cycles come from the time stamp counter where there is one.
+calc_sum is file static in the checksum sources, it is measured through
+calc_udp_chksum and calc_icmp_chksum, whose cost it is.
+
+Cases doing whole operations rather than bytes, such as the packet pipeline,
+read best in Mop/s, which is Mpps for packets.
+
+Usage: benchmark [-j results.jsonl] [-t tag] [-f filter]
+-j writes one JSON object per case so two versions can be diffed.
+-t stores a tag, e.g. the library version, in every JSON object.
+-f runs only the cases whose name contains the filter.
+
+Build: the library sources are parts of an application and take the libc
+headers and the shared types, e.g. app_stol_base_t and base_dec_c, from the
+application's common header, which this tree does not ship. Build them within
+the application, force-include the same header here and link, e.g.
+cc -O2 -include app.h benchmark.c udp-checksum.o icmp-checksum.o
+hex-to-string.o string-to-hex.o string-to-int32.o ipv6-p-to-n.o ipv6-n-to-p.o
+chksum-partial.o icmp-echo-responder.o cidr-aggregate.o rx-pipeline.o
+-pthread -o benchmark
+*/
+
+#define ipaddr_len_c 16
+/** See rx-pipeline.c. */
+#define app_cache_line_c 64
+/** See rx-pipeline.c. */
+#define app_pipe_max_workers_c 16
+/** See rx-pipeline.c. */
+#define app_pipe_no_core_c (-1)
+/** Size of IPv6 header */
+#define IP_IPH_LEN 40
+/** Types of Next header (Protocols) */
+#define IP_PROTO_UDP 17  /** UDP header */
+#define IP_PROTO_ICMP6 58  /** ICMPv6 header */
+
+/** Time a case is run for, per repetition. */
+#define bench_target_ns_c 20000000ull
+/** Repetitions of a case, the fastest is kept. */
+#define bench_repeat_c 5
+/** Largest packet: IPv6 header plus the largest payload length. */
+#define bench_max_pkt_c (IP_IPH_LEN + 0xffff)
+/** Size of the scratch buffers: the largest packet at every misalignment and
+the hex text of the largest input, rounded up for aligned_alloc(). */
+#define bench_buf_size_c ((2 * bench_max_pkt_c + 64 + 63) & ~63)
+
+/** IP address type. 0 for link local address, 1 for global address and 2 for
+ multicast address. The most significant byte is saved in byte 0. */
+typedef uint8_t ipaddr_t[ipaddr_len_c];
+
+/** The IPv6 header. */
+typedef struct ip_hdr_tag
+{
+    /** Version + Traffic class  */
+    uint8_t vtc;
+    /** Traffic class + Flow label */
+    uint8_t tcflow;
+    /** Flow label 16bits */
+    uint8_t flow[2];
+    /** Length of the IPv6 payload */
+    uint8_t len[2];
+    /** Type of header immediately following the IPv6 header. */
+    uint8_t proto;
+    /** Hop limit - Time to Live*/
+    uint8_t ttl;
+    /** 128-bit address of the originator of the packet. */
+    ipaddr_t srcaddr;
+    /** 128-bit address of the intended recipient of the packet */
+    ipaddr_t dstaddr;
+} ip_hdr_t;
+
+uint16_t calc_udp_chksum(ip_hdr_t * hdr);
+uint16_t calc_icmp_chksum(ip_hdr_t * hdr);
+uint16_t app_hex_to_ascii(uint8_t * ascii, uint8_t * hex, uint16_t len);
+uint16_t app_ascii_to_hex(uint8_t * hex, uint8_t * ascii,
+                          uint16_t len, uint8_t ** endptr);
+int32_t app_str_to_int32(uint8_t * s, uint8_t len, uint8_t ** endptr,
+                         app_stol_base_t base);
+uint8_t app_pton(uint8_t * src, uint8_t size, uint8_t * dst);
+uint8_t app_ntop(uint8_t * src, uint8_t bits, uint8_t * dst, uint8_t size);
+
+/** See chksum-partial.c. */
+typedef enum app_chksum_state_tag
+{
+    app_chksum_none_c = 0,
+    app_chksum_partial_c,
+    app_chksum_done_c
+} app_chksum_state_t;
+
+/** See chksum-partial.c. */
+typedef struct app_chksum_partial_tag
+{
+    uint16_t ip;
+    uint16_t start;
+    uint16_t offset;
+    uint16_t seed;
+    uint16_t len;
+    uint8_t proto;
+    uint8_t state;
+} app_chksum_partial_t;
+
+void app_chksum_partial_udp(uint8_t * pkt, app_chksum_partial_t * desc);
+uint16_t app_chksum_partial_finalize(uint8_t * pkt,
+                                     app_chksum_partial_t * desc);
+
+/** See icmp-echo-responder.c. */
+typedef struct app_echo_stats_tag
+{
+    uint16_t rx;
+    uint16_t replied;
+    uint16_t bad_len;
+    uint16_t bad_proto;
+    uint16_t bad_type;
+    uint16_t bad_src;
+    uint16_t no_local;
+} app_echo_stats_t;
+
+uint16_t app_icmp_echo_burst(ip_hdr_t ** pkts, const uint16_t * lens,
+                             uint16_t n, const uint8_t * local,
+                             ip_hdr_t ** dropped, app_echo_stats_t * stats);
+
+/** See cidr-aggregate.c. */
+typedef struct app_cidr_tag
+{
+    uint8_t addr[ipaddr_len_c];
+    uint8_t bits;
+} app_cidr_t;
+
+/** See cidr-aggregate.c. */
+typedef struct app_cidr_hist_tag
+{
+    size_t count[ipaddr_len_c + 1][256];
+} app_cidr_hist_t;
+
+size_t app_cidr_aggregate(app_cidr_t * list, size_t n, app_cidr_t * tmp,
+                          app_cidr_hist_t * hist);
+size_t app_cidr_format(const app_cidr_t * list, size_t n,
+                       uint8_t * dst, size_t size, size_t * used);
+
+/** See rx-pipeline.c. */
+typedef struct app_pkt_desc_tag
+{
+    ip_hdr_t * hdr;
+    uint16_t len;
+    uint8_t worker;
+    uint8_t status;
+    uint32_t flow_hash;
+    void * user;
+} app_pkt_desc_t;
+
+/** See rx-pipeline.c. */
+typedef struct app_spsc_ring_tag
+{
+    _Alignas(app_cache_line_c) _Atomic uint32_t head;
+    uint32_t tail_cache;
+    _Alignas(app_cache_line_c) _Atomic uint32_t tail;
+    uint32_t head_cache;
+    _Alignas(app_cache_line_c) uint32_t mask;
+    app_pkt_desc_t ** slots;
+} app_spsc_ring_t;
+
+/** See rx-pipeline.c. */
+typedef int32_t (* app_pipe_rx_fn)(void * ctx, app_pkt_desc_t ** descs,
+                                   uint16_t max);
+typedef void (* app_pipe_free_fn)(void * ctx, app_pkt_desc_t ** descs,
+                                  uint16_t n);
+typedef void (* app_pipe_deliver_fn)(void * ctx, app_pkt_desc_t ** descs,
+                                     uint16_t n);
+
+/** See rx-pipeline.c. */
+typedef struct app_pipe_cfg_tag
+{
+    uint8_t workers;
+    uint32_t ring_size;
+    int32_t rx_core;
+    int32_t worker_cores[app_pipe_max_workers_c];
+    int32_t deliver_core;
+    app_pipe_rx_fn rx;
+    app_pipe_free_fn release;
+    void * rx_ctx;
+    app_pipe_deliver_fn deliver;
+    void * deliver_ctx;
+} app_pipe_cfg_t;
+
+/** See rx-pipeline.c. */
+typedef struct app_pipe_worker_tag
+{
+    app_spsc_ring_t in;
+    app_spsc_ring_t out;
+    struct app_pipe_tag * pipe;
+    uint8_t index;
+    _Atomic bool done;
+    pthread_t thread;
+} app_pipe_worker_t;
+
+/** See rx-pipeline.c. */
+typedef struct app_pipe_tag
+{
+    app_pipe_cfg_t cfg;
+    app_pipe_worker_t workers[app_pipe_max_workers_c];
+    app_spsc_ring_t recycle;
+    _Atomic bool running;
+    _Atomic bool rx_done;
+    pthread_t rx_thread;
+    pthread_t deliver_thread;
+} app_pipe_t;
+
+/** See rx-pipeline.c. */
+typedef struct app_pktgen_tag
+{
+    uint8_t * buf;
+    app_pkt_desc_t * descs;
+    app_pkt_desc_t ** free;
+    uint32_t free_cnt;
+    uint32_t pool;
+    uint16_t pkt_len;
+    uint64_t remain;
+} app_pktgen_t;
+
+bool app_pipe_start(app_pipe_t * pipe, const app_pipe_cfg_t * cfg);
+void app_pipe_join(app_pipe_t * pipe);
+bool app_pktgen_init(app_pktgen_t * gen, uint32_t pool, uint16_t payload,
+                     uint32_t flows, uint64_t count);
+void app_pktgen_free(app_pktgen_t * gen);
+int32_t app_pktgen_rx(void * ctx, app_pkt_desc_t ** descs, uint16_t max);
+void app_pktgen_release(void * ctx, app_pkt_desc_t ** descs, uint16_t n);
+
+/** One benchmark case. */
+typedef struct bench_case_tag
+{
+    /** Name of the measured function or baseline. */
+    const char * name;
+    /** Parameter of the case, e.g. the size and the alignment. */
+    char param[48];
+    /** Bytes processed by one operation, 0 when not meaningful. */
+    size_t bytes;
+    /** Run the operation n times. */
+    void (* run)(struct bench_case_tag * c, uint64_t n);
+    /** Input of the operation. */
+    uint8_t * in;
+    /** Length of the input. */
+    size_t len;
+    /** Output of the operation. */
+    uint8_t * out;
+} bench_case_t;
+
+/** Result of a case. */
+typedef struct bench_result_tag
+{
+    double ns_per_op;
+    double gb_per_s;
+    double cycles_per_byte;
+    double cycles_per_op;
+    double mops_per_s;
+} bench_result_t;
+
+/** Sizes of the payload sweep. */
+static const uint32_t mSizes[] =
+{
+    64, 128, 256, 512, 1024, 1500, 4096, 9000, 16384, 32768, 65535
+};
+
+/** Misalignments of the payload sweep. */
+static const uint8_t mAligns[] = {0, 1, 2, 3};
+
+/** Presentations of the IPv6 input mix. */
+static const char * mAddrs[][2] =
+{
+    {"compressed", "2001:db8::1"},
+    {"full", "2001:0db8:85a3:0000:0000:8a2e:0370:7334"},
+    {"ipv4", "::ffff:192.0.2.128"},
+    {"prefixed", "2001:db8:abcd:12::/64"},
+    {"unspecified", "::"}
+};
+
+/** Burst size of the echo responder cases. */
+#define bench_burst_c 32
+
+/** Payload sizes of the echo responder cases, a burst of the largest fits
+into one scratch buffer. */
+static const uint32_t mEchoSizes[] = {64, 128, 256};
+
+/** Worker counts of the pipeline sweep. */
+static const uint8_t mWorkers[] = {1, 2, 4, 8};
+
+/** Slots of every ring of the pipeline cases. */
+#define bench_pipe_ring_c 512
+
+/** UDP payload of the pipeline cases. */
+#define bench_pipe_payload_c 256
+
+/** Address pairs of the pipeline cases, enough to spread over the workers. */
+#define bench_pipe_flows_c 1024
+
+/** Numbers of prefixes of the aggregation cases. */
+static const uint32_t mPrefixes[] = {1000, 100000, 1000000};
+
+/** Random prefixes of the app_cidr_format() round trip check. */
+#define bench_format_checks_c 200000
+
+/** Prefixes the round trip check starts with, zero runs that app_ntop()
+compresses differently at the prefix length than in the full address. */
+static const app_cidr_t mFormatEdges[] =
+{
+    {{0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0x01}, 80},
+    {{0, 0, 0, 0, 0, 0, 0x80}, 52},
+    {{0}, 0},
+    {{0}, 128}
+};
+
+/** Decimal strings of the integer parsing mix. */
+static const char * mInts[] = {"7", "-4096", "2147483647", "00012345"};
+
+/** Keeps the compiler from dropping results. */
+static volatile uint32_t mSink;
+
+/** JSON results, NULL when not requested. */
+static FILE * mJson;
+
+/** Tag written to every JSON object. */
+static const char * mTag = "";
+
+/** Only cases whose name contains this run. */
+static const char * mFilter = NULL;
+
+/**
+Read the cycle counter.
+@return The cycle count, 0 where there is no cycle counter.
+*/
+static uint64_t bench_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/**
+Read the monotonic clock.
+@return The time in ns.
+*/
+static uint64_t bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/**
+Write a string to the JSON results as a quoted JSON string.
+@param[in] str The string.
+*/
+static void bench_json_string(const char * str)
+{
+    const unsigned char * p;
+
+    fputc('"', mJson);
+    for (p = (const unsigned char *) str; '\0' != *p; ++p)
+    {
+        if (('"' == *p) || ('\\' == *p))
+        {
+            fputc('\\', mJson);
+            fputc(*p, mJson);
+        }
+        else if (*p < 0x20)
+        {
+            fprintf(mJson, "\\u%04x", *p);
+        }
+        else
+        {
+            fputc(*p, mJson);
+        }
+    }
+    fputc('"', mJson);
+}
+
+/**
+Print a result and append it to the JSON results.
+@param[in] c The case.
+@param[in] r The result.
+*/
+static void bench_report(const bench_case_t * c, const bench_result_t * r)
+{
+    printf("%-22s %-26s %12.2f %10.3f %12.3f %10.3f\n",
+           c->name, c->param, r->ns_per_op, r->gb_per_s, r->cycles_per_byte,
+           r->mops_per_s);
+
+    if (NULL != mJson)
+    {
+        fputs("{\"tag\":", mJson);
+        bench_json_string(mTag);
+        fputs(",\"name\":", mJson);
+        bench_json_string(c->name);
+        fputs(",\"param\":", mJson);
+        bench_json_string(c->param);
+        fprintf(mJson, ",\"bytes\":%zu,\"ns_per_op\":%.3f,\"gb_per_s\":%.4f,"
+                "\"cycles_per_op\":%.2f,\"cycles_per_byte\":%.4f,"
+                "\"mops_per_s\":%.4f}\n",
+                c->bytes, r->ns_per_op, r->gb_per_s, r->cycles_per_op,
+                r->cycles_per_byte, r->mops_per_s);
+    }
+}
+
+/**
+Measure a case and report it.
+@param[in] c The case.
+*/
+static void bench_measure(bench_case_t * c)
+{
+    bench_result_t r;
+    uint64_t n = 1;
+    uint64_t t0;
+    uint64_t t1;
+    uint64_t c0;
+    uint64_t c1;
+    uint64_t best_ns = UINT64_MAX;
+    uint64_t best_cycles = UINT64_MAX;
+    uint8_t i;
+
+    if ((NULL != mFilter) && (NULL == strstr(c->name, mFilter)))
+    {
+        return;
+    }
+
+    /* Calibrate: double n until one run takes a tenth of the target. */
+    for (;;)
+    {
+        t0 = bench_now();
+        c->run(c, n);
+        t1 = bench_now();
+        if ((t1 - t0) * 10 >= bench_target_ns_c)
+        {
+            n = n * bench_target_ns_c / (t1 - t0 + 1) + 1;
+            break;
+        }
+        n *= 2;
+    }
+
+    for (i = 0; i < bench_repeat_c; ++i)
+    {
+        t0 = bench_now();
+        c0 = bench_cycles();
+        c->run(c, n);
+        c1 = bench_cycles();
+        t1 = bench_now();
+        if (t1 - t0 < best_ns)
+        {
+            best_ns = t1 - t0;
+            best_cycles = c1 - c0;
+        }
+    }
+
+    r.ns_per_op = (double) best_ns / n;
+    r.cycles_per_op = (double) best_cycles / n;
+    r.gb_per_s = (0 != c->bytes) ? c->bytes / r.ns_per_op : 0;
+    r.cycles_per_byte = (0 != c->bytes) ? r.cycles_per_op / c->bytes : 0;
+    r.mops_per_s = 1000 / r.ns_per_op;
+
+    bench_report(c, &r);
+}
+
+/**
+Fill an IPv6 packet with an upper layer of the given length.
+@param[in] pkt The packet.
+@param[in] proto The upper layer protocol.
+@param[in] len Length of the upper layer in bytes.
+*/
+static void bench_packet(uint8_t * pkt, uint8_t proto, uint16_t len)
+{
+    ip_hdr_t * hdr = (ip_hdr_t *) pkt;
+    uint32_t i;
+
+    for (i = 0; i < (uint32_t) IP_IPH_LEN + len; ++i)
+    {
+        pkt[i] = (uint8_t) (i * 131 + 7);
+    }
+    hdr->vtc = 0x60;
+    hdr->len[0] = (uint8_t) (len >> 8);
+    hdr->len[1] = (uint8_t) len;
+    hdr->proto = proto;
+}
+
+static void bench_run_udp(bench_case_t * c, uint64_t n)
+{
+    uint32_t acc = 0;
+
+    while (n-- > 0)
+    {
+        acc += calc_udp_chksum((ip_hdr_t *) c->in);
+    }
+    mSink = acc;
+}
+
+static void bench_run_icmp(bench_case_t * c, uint64_t n)
+{
+    uint32_t acc = 0;
+
+    while (n-- > 0)
+    {
+        acc += calc_icmp_chksum((ip_hdr_t *) c->in);
+    }
+    mSink = acc;
+}
+
+static void bench_run_partial(bench_case_t * c, uint64_t n)
+{
+    app_chksum_partial_t desc;
+    uint32_t acc = 0;
+
+    app_chksum_partial_udp(c->in, &desc);
+    while (n-- > 0)
+    {
+        /* Back to app_chksum_partial_c with the field cleared, as
+        app_chksum_partial_udp() leaves it, so every call sums the payload
+        and writes the same checksum. */
+        desc.state = app_chksum_partial_c;
+        c->in[desc.start + desc.offset] = 0;
+        c->in[desc.start + desc.offset + 1] = 0;
+        acc += app_chksum_partial_finalize(c->in, &desc);
+    }
+    mSink = acc;
+}
+
+/**
+Sweep the checksums over payload sizes and alignments.
+@param[in] buf Scratch memory for the packets.
+*/
+static void bench_checksums(uint8_t * buf)
+{
+    bench_case_t c;
+    uint16_t len;
+    uint8_t s;
+    uint8_t a;
+
+    for (s = 0; s < sizeof(mSizes) / sizeof(mSizes[0]); ++s)
+    {
+        len = (uint16_t) mSizes[s];
+        for (a = 0; a < sizeof(mAligns); ++a)
+        {
+            memset(&c, 0, sizeof(c));
+            c.in = buf + mAligns[a];
+            c.bytes = len + 2 * ipaddr_len_c;
+            snprintf(c.param, sizeof(c.param), "len=%u align=%u",
+                     len, mAligns[a]);
+
+            bench_packet(c.in, IP_PROTO_UDP, len);
+            c.name = "calc_udp_chksum";
+            c.run = bench_run_udp;
+            bench_measure(&c);
+
+            c.name = "app_chksum_partial";
+            c.run = bench_run_partial;
+            bench_measure(&c);
+
+            bench_packet(c.in, IP_PROTO_ICMP6, len);
+            c.name = "calc_icmp_chksum";
+            c.run = bench_run_icmp;
+            bench_measure(&c);
+        }
+    }
+}
+
+static void bench_run_hex_enc(bench_case_t * c, uint64_t n)
+{
+    uint32_t acc = 0;
+
+    while (n-- > 0)
+    {
+        acc += app_hex_to_ascii(c->out, c->in, (uint16_t) c->len);
+    }
+    mSink = acc + c->out[0];
+}
+
+static void bench_run_hex_dec(bench_case_t * c, uint64_t n)
+{
+    uint8_t * endptr;
+    uint32_t acc = 0;
+
+    while (n-- > 0)
+    {
+        acc += app_ascii_to_hex(c->out, c->in, (uint16_t) c->len, &endptr);
+    }
+    mSink = acc + c->out[0];
+}
+
+/**
+Sweep the hex codec over sizes and alignments.
+@param[in] buf Scratch memory for the input.
+@param[in] out Scratch memory for the output.
+*/
+static void bench_hex(uint8_t * buf, uint8_t * out)
+{
+    bench_case_t c;
+    uint32_t len;
+    uint32_t i;
+    uint8_t s;
+    uint8_t a;
+
+    for (s = 0; s < sizeof(mSizes) / sizeof(mSizes[0]); ++s)
+    {
+        /* app_hex_to_ascii() takes at most 0x7FFF bytes. */
+        len = (mSizes[s] > 0x7fff) ? 0x7fff : mSizes[s];
+        for (a = 0; a < sizeof(mAligns); ++a)
+        {
+            memset(&c, 0, sizeof(c));
+            c.in = buf + mAligns[a];
+            c.out = out + mAligns[a];
+            c.len = len;
+            c.bytes = len;
+            snprintf(c.param, sizeof(c.param), "len=%u align=%u",
+                     len, mAligns[a]);
+            for (i = 0; i < len; ++i)
+            {
+                c.in[i] = (uint8_t) (i * 131 + 7);
+            }
+            c.name = "app_hex_to_ascii";
+            c.run = bench_run_hex_enc;
+            bench_measure(&c);
+
+            /* Mixed case text. */
+            for (i = 0; i < 2 * len; ++i)
+            {
+                c.in[i] = "0123456789ABCDEFabcdef"[(i * 7) % 22];
+            }
+            c.len = 2 * len;
+            c.bytes = 2 * len;
+            c.name = "app_ascii_to_hex";
+            c.run = bench_run_hex_dec;
+            bench_measure(&c);
+        }
+    }
+}
+
+static void bench_run_int32(bench_case_t * c, uint64_t n)
+{
+    uint8_t * endptr;
+    uint32_t acc = 0;
+
+    while (n-- > 0)
+    {
+        acc += app_str_to_int32(c->in, (uint8_t) c->len, &endptr, base_dec_c);
+    }
+    mSink = acc;
+}
+
+static void bench_run_strtol(bench_case_t * c, uint64_t n)
+{
+    char str[34];
+    char * endptr;
+    uint32_t acc = 0;
+
+    while (n-- > 0)
+    {
+        memcpy(str, c->in, c->len);
+        str[c->len] = '\0';
+        acc += strtol(str, &endptr, 10);
+    }
+    mSink = acc;
+}
+
+/**
+Measure integer parsing, with strtol() as the baseline.
+@param[in] buf Scratch memory for the input.
+*/
+static void bench_int32(uint8_t * buf)
+{
+    bench_case_t c;
+    uint8_t s;
+
+    for (s = 0; s < sizeof(mInts) / sizeof(mInts[0]); ++s)
+    {
+        memset(&c, 0, sizeof(c));
+        c.in = buf;
+        c.len = strlen(mInts[s]);
+        c.bytes = c.len;
+        memcpy(c.in, mInts[s], c.len);
+        snprintf(c.param, sizeof(c.param), "%s", mInts[s]);
+
+        c.name = "app_str_to_int32";
+        c.run = bench_run_int32;
+        bench_measure(&c);
+
+        c.name = "strtol";
+        c.run = bench_run_strtol;
+        bench_measure(&c);
+    }
+}
+
+static void bench_run_pton(bench_case_t * c, uint64_t n)
+{
+    uint32_t acc = 0;
+
+    while (n-- > 0)
+    {
+        acc += app_pton(c->in, (uint8_t) c->len, c->out);
+    }
+    mSink = acc + c->out[15];
+}
+
+static void bench_run_inet_pton(bench_case_t * c, uint64_t n)
+{
+    uint32_t acc = 0;
+
+    while (n-- > 0)
+    {
+        acc += inet_pton(AF_INET6, (const char *) c->in, c->out);
+    }
+    mSink = acc + c->out[15];
+}
+
+/**
+Measure presentation to network conversion over the address mix, with
+inet_pton() as the baseline. inet_pton() has no prefixes, the prefixed
+address is given to it without the "/length".
+@param[in] buf Scratch memory for the input.
+@param[in] out Scratch memory for the output.
+*/
+static void bench_pton(uint8_t * buf, uint8_t * out)
+{
+    bench_case_t c;
+    char * slash;
+    uint8_t s;
+
+    for (s = 0; s < sizeof(mAddrs) / sizeof(mAddrs[0]); ++s)
+    {
+        memset(&c, 0, sizeof(c));
+        c.in = buf;
+        c.out = out;
+        c.len = strlen(mAddrs[s][1]);
+        c.bytes = c.len;
+        memcpy(c.in, mAddrs[s][1], c.len + 1);
+        snprintf(c.param, sizeof(c.param), "%s", mAddrs[s][0]);
+
+        c.name = "app_pton";
+        c.run = bench_run_pton;
+        bench_measure(&c);
+
+        slash = strchr((char *) c.in, '/');
+        if (NULL != slash)
+        {
+            *slash = '\0';
+        }
+        c.name = "inet_pton";
+        c.run = bench_run_inet_pton;
+        bench_measure(&c);
+    }
+}
+
+static void bench_run_ntop(bench_case_t * c, uint64_t n)
+{
+    uint8_t text[64];
+    uint32_t acc = 0;
+
+    while (n-- > 0)
+    {
+        acc += app_ntop(c->in, (uint8_t) c->len, text, sizeof(text));
+    }
+    mSink = acc;
+}
+
+static void bench_run_inet_ntop(bench_case_t * c, uint64_t n)
+{
+    char text[INET6_ADDRSTRLEN];
+    uint32_t acc = 0;
+
+    while (n-- > 0)
+    {
+        acc += (NULL != inet_ntop(AF_INET6, c->in, text, sizeof(text)));
+    }
+    mSink = acc + text[0];
+}
+
+/**
+Measure network to presentation conversion over the address mix, with
+inet_ntop() as the baseline. The bytes of a case are those of the text.
+@param[in] out Scratch memory for the network numbers.
+*/
+static void bench_ntop(uint8_t * out)
+{
+    bench_case_t c;
+    uint8_t text[64];
+    uint8_t s;
+
+    for (s = 0; s < sizeof(mAddrs) / sizeof(mAddrs[0]); ++s)
+    {
+        memset(&c, 0, sizeof(c));
+        c.in = out + s * ipaddr_len_c;
+        /* The prefix length travels in len. */
+        c.len = app_pton((uint8_t *) mAddrs[s][1],
+                         (uint8_t) strlen(mAddrs[s][1]), c.in);
+        c.bytes = app_ntop(c.in, (uint8_t) c.len, text, sizeof(text));
+        snprintf(c.param, sizeof(c.param), "%s", mAddrs[s][0]);
+
+        c.name = "app_ntop";
+        c.run = bench_run_ntop;
+        bench_measure(&c);
+
+        c.name = "inet_ntop";
+        c.run = bench_run_inet_ntop;
+        bench_measure(&c);
+    }
+}
+
+static void bench_run_echo(bench_case_t * c, uint64_t n)
+{
+    ip_hdr_t * pkts[bench_burst_c];
+    uint16_t lens[bench_burst_c];
+    app_echo_stats_t stats;
+    uint32_t acc = 0;
+    uint8_t i;
+
+    for (i = 0; i < bench_burst_c; ++i)
+    {
+        lens[i] = (uint16_t) c->len;
+    }
+    while (n-- > 0)
+    {
+        for (i = 0; i < bench_burst_c; ++i)
+        {
+            pkts[i] = (ip_hdr_t *) (c->in + i * c->len);
+            /* Turn the reply of the previous run back into a request. */
+            c->in[i * c->len + IP_IPH_LEN] = 128;
+        }
+        acc += app_icmp_echo_burst(pkts, lens, bench_burst_c, NULL, NULL,
+                                   &stats);
+    }
+    mSink = acc;
+}
+
+/**
+Measure the echo responder over bursts of requests of some sizes. The payload
+is not read, so no bytes are reported.
+@param[in] buf Scratch memory for the packets.
+*/
+static void bench_echo(uint8_t * buf)
+{
+    bench_case_t c;
+    ip_hdr_t * hdr;
+    uint8_t s;
+    uint8_t i;
+
+    for (s = 0; s < sizeof(mEchoSizes) / sizeof(mEchoSizes[0]); ++s)
+    {
+        memset(&c, 0, sizeof(c));
+        c.in = buf;
+        c.len = IP_IPH_LEN + mEchoSizes[s];
+        for (i = 0; i < bench_burst_c; ++i)
+        {
+            bench_packet(buf + i * c.len, IP_PROTO_ICMP6,
+                         (uint16_t) mEchoSizes[s]);
+            hdr = (ip_hdr_t *) (buf + i * c.len);
+            hdr->srcaddr[0] = 0x20;
+            hdr->dstaddr[0] = 0x20;
+            buf[i * c.len + IP_IPH_LEN + 1] = 0;
+        }
+        snprintf(c.param, sizeof(c.param), "burst=%u len=%u",
+                 bench_burst_c, mEchoSizes[s]);
+        c.name = "app_icmp_echo_burst";
+        c.run = bench_run_echo;
+        bench_measure(&c);
+    }
+}
+
+static void bench_run_cidr(bench_case_t * c, uint64_t n)
+{
+    static app_cidr_hist_t hist;
+    app_cidr_t * list = (app_cidr_t *) c->out;
+    app_cidr_t * tmp = list + c->len;
+    size_t acc = 0;
+
+    while (n-- > 0)
+    {
+        memcpy(list, c->in, c->len * sizeof(app_cidr_t));
+        acc += app_cidr_aggregate(list, c->len, tmp, &hist);
+    }
+    mSink = (uint32_t) acc;
+}
+
+/**
+Measure prefix aggregation over random prefixes of 2001:db8::/32 with
+lengths from /33 to /64, so some cover and some neighbour each other.
+*/
+static void bench_cidr(void)
+{
+    bench_case_t c;
+    app_cidr_t * in;
+    uint32_t i;
+    uint8_t j;
+    uint8_t s;
+
+    for (s = 0; s < sizeof(mPrefixes) / sizeof(mPrefixes[0]); ++s)
+    {
+        memset(&c, 0, sizeof(c));
+        c.len = mPrefixes[s];
+        c.bytes = c.len * sizeof(app_cidr_t);
+        c.in = malloc(c.bytes);
+        c.out = malloc(2 * c.bytes);
+        if ((NULL == c.in) || (NULL == c.out))
+        {
+            free(c.in);
+            free(c.out);
+            return;
+        }
+
+        in = (app_cidr_t *) c.in;
+        srand(s);
+        for (i = 0; i < c.len; ++i)
+        {
+            for (j = 0; j < ipaddr_len_c; ++j)
+            {
+                in[i].addr[j] = (uint8_t) rand();
+            }
+            in[i].addr[0] = 0x20;
+            in[i].addr[1] = 0x01;
+            in[i].addr[2] = 0x0d;
+            in[i].addr[3] = 0xb8;
+            /* Dense enough in the upper bits to find covers and siblings. */
+            in[i].addr[4] &= 0x0f;
+            in[i].bits = (uint8_t) (33 + rand() % 32);
+        }
+        snprintf(c.param, sizeof(c.param), "prefixes=%u", mPrefixes[s]);
+        c.name = "app_cidr_aggregate";
+        c.run = bench_run_cidr;
+        bench_measure(&c);
+
+        free(c.in);
+        free(c.out);
+    }
+}
+
+static void bench_pipe_deliver(void * ctx, app_pkt_desc_t ** descs,
+                               uint16_t n)
+{
+    (void) ctx;
+    (void) descs;
+    mSink += n;
+}
+
+static void bench_run_pipe(bench_case_t * c, uint64_t n)
+{
+    app_pktgen_t * gen = (app_pktgen_t *) c->in;
+    app_pipe_t * pipe = (app_pipe_t *) c->out;
+    app_pipe_cfg_t cfg;
+    uint8_t i;
+
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.workers = (uint8_t) c->len;
+    cfg.ring_size = bench_pipe_ring_c;
+    cfg.rx_core = app_pipe_no_core_c;
+    cfg.deliver_core = app_pipe_no_core_c;
+    for (i = 0; i < app_pipe_max_workers_c; ++i)
+    {
+        cfg.worker_cores[i] = app_pipe_no_core_c;
+    }
+    cfg.rx = app_pktgen_rx;
+    cfg.release = app_pktgen_release;
+    cfg.rx_ctx = gen;
+    cfg.deliver = bench_pipe_deliver;
+
+    /* Every descriptor is back in the pool after app_pipe_join(), the
+    generator only needs a new count. */
+    gen->remain = n;
+    if (!app_pipe_start(pipe, &cfg))
+    {
+        fprintf(stderr, "app_pipe_start failed, workers=%u\n", cfg.workers);
+        exit(1);
+    }
+    app_pipe_join(pipe);
+}
+
+/**
+Measure the receive pipeline over generated UDP packets while sweeping the
+number of checksum workers. An operation is a packet, so the Mop/s column is
+the throughput in Mpps. The stages are not pinned, the sweep only scales as
+far as the machine has cores for the receive, worker and delivery threads.
+*/
+static void bench_pipe(void)
+{
+    bench_case_t c;
+    app_pktgen_t gen;
+    app_pipe_t * pipe;
+    uint8_t s;
+
+    pipe = aligned_alloc(app_cache_line_c,
+                         (sizeof(app_pipe_t) + app_cache_line_c - 1) &
+                         ~(app_cache_line_c - 1));
+    if (NULL == pipe)
+    {
+        return;
+    }
+
+    for (s = 0; s < sizeof(mWorkers) / sizeof(mWorkers[0]); ++s)
+    {
+        /* Enough packets in flight to fill the ring of every worker. */
+        if (!app_pktgen_init(&gen, bench_pipe_ring_c * (mWorkers[s] + 1),
+                             bench_pipe_payload_c, bench_pipe_flows_c, 0))
+        {
+            break;
+        }
+        memset(&c, 0, sizeof(c));
+        c.len = mWorkers[s];
+        c.bytes = gen.pkt_len;
+        c.in = (uint8_t *) &gen;
+        c.out = (uint8_t *) pipe;
+        snprintf(c.param, sizeof(c.param), "workers=%u payload=%u",
+                 mWorkers[s], bench_pipe_payload_c);
+        c.name = "app_pipe";
+        c.run = bench_run_pipe;
+        bench_measure(&c);
+        app_pktgen_free(&gen);
+    }
+
+    free(pipe);
+}
+
+/**
+Check that the text of app_cidr_format() reads back as the same prefixes,
+parsed with inet_pton() and strtoul() rather than with app_pton(), which
+returns 0 for both ::/0 and a syntax error.
+@param[in] list The prefixes.
+@param[in] n The number of prefixes.
+@param[out] buf Scratch for the text.
+@param[in] size Size of the scratch.
+@return The number of prefixes which do not read back.
+*/
+static size_t bench_check_format(const app_cidr_t * list, size_t n,
+                                 uint8_t * buf, size_t size)
+{
+    char text[64];
+    struct in6_addr addr;
+    unsigned long bits;
+    size_t done = 0;
+    size_t used;
+    size_t bad = 0;
+    size_t k;
+    char * line;
+    char * end;
+    char * slash;
+
+    while (done < n)
+    {
+        k = app_cidr_format(list + done, n - done, buf, size, &used);
+        if (0 == k)
+        {
+            return bad + n - done;
+        }
+        line = (char *) buf;
+        for (; k > 0; --k, ++done)
+        {
+            end = memchr(line, '\n', (size_t) ((char *) buf + used - line));
+            if ((NULL == end) || ((size_t) (end - line) >= sizeof(text)))
+            {
+                return bad + n - done;
+            }
+            memcpy(text, line, (size_t) (end - line));
+            text[end - line] = '\0';
+            line = end + 1;
+
+            bits = 128;
+            slash = strchr(text, '/');
+            if (NULL != slash)
+            {
+                *slash = '\0';
+                bits = strtoul(slash + 1, NULL, 10);
+            }
+            if ((1 != inet_pton(AF_INET6, text, &addr))
+                || (bits != list[done].bits)
+                || (0 != memcmp(&addr, list[done].addr, ipaddr_len_c)))
+            {
+                if (bad < 8)
+                {
+                    fprintf(stderr, "app_cidr_format: %s%s%s does not read "
+                            "back as prefix %zu\n", text,
+                            (NULL != slash) ? "/" : "",
+                            (NULL != slash) ? slash + 1 : "", done);
+                }
+                ++bad;
+            }
+        }
+    }
+    return bad;
+}
+
+/**
+Round trip the edge prefixes and random prefixes of every length, with
+runs of zero words, through app_cidr_format() before measuring anything.
+@param[out] buf Scratch of bench_buf_size_c bytes.
+@return true when every prefix reads back.
+*/
+static bool bench_check_cidr(uint8_t * buf)
+{
+    app_cidr_t * list;
+    size_t bad;
+    uint32_t i;
+    uint8_t j;
+
+    list = malloc(bench_format_checks_c * sizeof(app_cidr_t));
+    if (NULL == list)
+    {
+        return false;
+    }
+    memcpy(list, mFormatEdges, sizeof(mFormatEdges));
+    srand(1);
+    for (i = sizeof(mFormatEdges) / sizeof(mFormatEdges[0]);
+         i < bench_format_checks_c; ++i)
+    {
+        for (j = 0; j < ipaddr_len_c; j += 2)
+        {
+            /* Mostly zero words, so app_ntop() has runs to compress. */
+            list[i].addr[j] = (0 == rand() % 2) ? 0 : (uint8_t) rand();
+            list[i].addr[j + 1] = (0 == list[i].addr[j]) ? 0 : (uint8_t) rand();
+        }
+        list[i].bits = (uint8_t) (rand() % 129);
+    }
+    bad = bench_check_format(list, bench_format_checks_c, buf,
+                             bench_buf_size_c);
+    if (0 != bad)
+    {
+        fprintf(stderr, "app_cidr_format: %zu of %u prefixes do not read "
+                "back\n", bad, bench_format_checks_c);
+    }
+    free(list);
+    return 0 == bad;
+}
+
+int main(int argc, char ** argv)
+{
+    uint8_t * buf;
+    uint8_t * out;
+    int i;
+
+    for (i = 1; i < argc; ++i)
+    {
+        if ((0 == strcmp(argv[i], "-j")) && (i + 1 < argc))
+        {
+            mJson = fopen(argv[++i], "w");
+            if (NULL == mJson)
+            {
+                perror(argv[i]);
+                return 1;
+            }
+        }
+        else if ((0 == strcmp(argv[i], "-t")) && (i + 1 < argc))
+        {
+            mTag = argv[++i];
+        }
+        else if ((0 == strcmp(argv[i], "-f")) && (i + 1 < argc))
+        {
+            mFilter = argv[++i];
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-j results.jsonl] [-t tag] "
+                    "[-f filter]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    buf = aligned_alloc(64, bench_buf_size_c);
+    out = aligned_alloc(64, bench_buf_size_c);
+    if ((NULL == buf) || (NULL == out))
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    if (!bench_check_cidr(buf))
+    {
+        return 1;
+    }
+
+    printf("%-22s %-26s %12s %10s %12s %10s\n",
+           "function", "param", "ns/op", "GB/s", "cycles/B", "Mop/s");
+
+    bench_checksums(buf);
+    bench_hex(buf, out);
+    bench_int32(buf);
+    bench_pton(buf, out);
+    bench_ntop(out);
+    bench_echo(buf);
+    bench_cidr();
+    bench_pipe();
+
+    if (NULL != mJson)
+    {
+        fclose(mJson);
+    }
+    free(buf);
+    free(out);
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,241 @@
+#define ipaddr_len_c 16
+/** Size of IPv6 header */
+#define IP_IPH_LEN 40
+/** Types of Next header (Protocols) */
+#define IP_PROTO_UDP 17  /** UDP header */
+#define IP_PROTO_ICMP6 58  /** ICMPv6 header */
+/** Offset of the checksum field in the upper layer header */
+#define UDP_CHKSUM_OFFSET 6
+#define ICMP6_CHKSUM_OFFSET 2
+
+/** IP address type. 0 for link local address, 1 for global address and 2 for
+ multicast address. The most significant byte is saved in byte 0. */
+typedef uint8_t ipaddr_t[ipaddr_len_c];
+
+/** State of a deferred checksum. */
+typedef enum app_chksum_state_tag
+{
+    /** No deferred checksum, the packet is sent as it is. */
+    app_chksum_none_c = 0,
+    /** Seed recorded, the checksum field is not valid yet. */
+    app_chksum_partial_c,
+    /** Checksum field written. */
+    app_chksum_done_c
+} app_chksum_state_t;
+
+/** Deferred upper layer checksum of a packet, in the spirit of the Linux
+CHECKSUM_PARTIAL mode. Offsets are relative to the start of the packet, so
+prepending headers only needs app_chksum_partial_push(). */
+typedef struct app_chksum_partial_tag
+{
+    /** Offset of the IPv6 header carrying the pseudo-header fields. */
+    uint16_t ip;
+    /** Offset of the upper layer header, where summing starts. */
+    uint16_t start;
+    /** Offset of the checksum field from start. */
+    uint16_t offset;
+    /** Sum of the pseudo-header in host byte order. */
+    uint16_t seed;
+    /** Upper layer length the seed was taken with. */
+    uint16_t len;
+    /** The upper layer protocol. */
+    uint8_t proto;
+    /** See app_chksum_state_t. */
+    uint8_t state;
+} app_chksum_partial_t;
+
+/**
+Defer the udp checksum of a packet. Only the pseudo-header is summed now.
+@param[in] pkt The packet starting with its IPv6 header.
+@param[out] desc The deferred checksum of the packet.
+*/
+void app_chksum_partial_udp(uint8_t * pkt, app_chksum_partial_t * desc)
+{
+    app_chksum_partial_init(pkt, IP_PROTO_UDP, UDP_CHKSUM_OFFSET, desc);
+}
+
+/**
+Defer the icmp checksum of a packet. Only the pseudo-header is summed now.
+@param[in] pkt The packet starting with its IPv6 header.
+@param[out] desc The deferred checksum of the packet.
+*/
+void app_chksum_partial_icmp(uint8_t * pkt, app_chksum_partial_t * desc)
+{
+    app_chksum_partial_init(pkt, IP_PROTO_ICMP6, ICMP6_CHKSUM_OFFSET, desc);
+}
+
+/**
+Record that headers have been prepended to the packet, e.g. on encapsulation.
+@param[in,out] desc The deferred checksum of the packet.
+@param[in] len The number of bytes prepended.
+*/
+void app_chksum_partial_push(app_chksum_partial_t * desc, uint16_t len)
+{
+    desc->ip += len;
+    desc->start += len;
+}
+
+/**
+Sum the pseudo-header again after the addresses or the payload length of the
+packet have been rewritten. When the checksum has already been written and only
+the addresses changed it is updated incrementally, so the payload is still
+summed at most once. A new payload length changes which bytes are summed, so
+the checksum is deferred again and app_chksum_partial_finalize() sums anew.
+@param[in] pkt The packet, starting where desc offsets start.
+@param[in,out] desc The deferred checksum of the packet.
+*/
+void app_chksum_partial_reseed(uint8_t * pkt, app_chksum_partial_t * desc)
+{
+    uint16_t old_seed = desc->seed;
+    uint16_t old_len = desc->len;
+    uint16_t chksum;
+    uint8_t * field;
+
+    if (app_chksum_none_c == desc->state)
+    {
+        return;
+    }
+
+    desc->seed = app_chksum_partial_seed(pkt + desc->ip, desc->proto);
+    desc->len = (pkt[desc->ip + 4] << 8) + pkt[desc->ip + 5];
+    field = pkt + desc->start + desc->offset;
+    if ((app_chksum_done_c == desc->state) && (old_len != desc->len))
+    {
+        /* The field must not count in the final sum. */
+        field[0] = 0;
+        field[1] = 0;
+        desc->state = app_chksum_partial_c;
+    }
+    else if ((app_chksum_done_c == desc->state) && (old_seed != desc->seed))
+    {
+        /* The seed acts as one changed word of the covered data. */
+        chksum = (field[0] << 8) + field[1];
+        chksum = app_chksum_adjust(chksum, old_seed, desc->seed);
+        chksum = app_chksum_partial_fixup(desc->proto, chksum);
+        field[0] = (uint8_t)(chksum >> 8);
+        field[1] = (uint8_t)chksum;
+    }
+}
+
+/**
+Complete a deferred checksum at the transmit boundary. The payload is summed
+here, and only the first time.
+@param[in,out] pkt The packet, starting where desc offsets start.
+@param[in,out] desc The deferred checksum of the packet.
+@return The checksum in host byte order, as written to the packet.
+*/
+uint16_t app_chksum_partial_finalize(uint8_t * pkt,
+                                     app_chksum_partial_t * desc)
+{
+    uint16_t upper_layer_len;
+    uint16_t sum;
+    uint8_t * field = pkt + desc->start + desc->offset;
+
+    if (app_chksum_partial_c == desc->state)
+    {
+        upper_layer_len = (pkt[desc->ip + 4] << 8) + pkt[desc->ip + 5];
+        sum = calc_sum(desc->seed, pkt + desc->start, upper_layer_len);
+        sum = app_chksum_partial_fixup(desc->proto, 0xffff - sum);
+        field[0] = (uint8_t)(sum >> 8);
+        field[1] = (uint8_t)sum;
+        desc->state = app_chksum_done_c;
+    }
+
+    return (field[0] << 8) + field[1];
+}
+
+/**
+Record a deferred checksum and clear the checksum field, so the field does not
+count in the final sum.
+@param[in] pkt The packet starting with its IPv6 header.
+@param[in] proto The upper layer protocol.
+@param[in] offset Offset of the checksum field in the upper layer header.
+@param[out] desc The deferred checksum of the packet.
+*/
+static void app_chksum_partial_init(uint8_t * pkt, uint8_t proto,
+                                    uint16_t offset,
+                                    app_chksum_partial_t * desc)
+{
+    desc->ip = 0;
+    desc->start = IP_IPH_LEN;
+    desc->offset = offset;
+    desc->proto = proto;
+    desc->seed = app_chksum_partial_seed(pkt, proto);
+    desc->len = (pkt[4] << 8) + pkt[5];
+    desc->state = app_chksum_partial_c;
+
+    pkt[IP_IPH_LEN + offset] = 0;
+    pkt[IP_IPH_LEN + offset + 1] = 0;
+}
+
+/**
+Sum the pseudo-header according to rfc 2460 section 8.1.
+@param[in] ip The IPv6 header.
+@param[in] proto The upper layer protocol.
+@return The sum in host byte order.
+*/
+static uint16_t app_chksum_partial_seed(const uint8_t * ip, uint8_t proto)
+{
+    uint16_t sum;
+
+    /* Payload length and both addresses, see ip_hdr_t. */
+    sum = ((ip[4]) << 8) + ip[5] + proto;
+    return calc_sum(sum, ip + 8, 2 * ipaddr_len_c);
+}
+
+/**
+Apply the rule of rfc 2460 section 8.1 that a computed udp checksum of zero is
+transmitted as all ones, since zero means no checksum for udp.
+@param[in] proto The upper layer protocol.
+@param[in] chksum The computed checksum.
+@return The checksum to transmit.
+*/
+static uint16_t app_chksum_partial_fixup(uint8_t proto, uint16_t chksum)
+{
+    if ((IP_PROTO_UDP == proto) && (0 == chksum))
+    {
+        chksum = 0xffff;
+    }
+
+    return chksum;
+}
+
+/**
+Calculate sum of a series of data.
+@param[in] sum The separated number to be added in the calculation.
+@param[in] data The pointer to the data.
+@param[in] len The length of the data in bytes.
+@return The checksum in host byte order.
+*/
+static uint16_t calc_sum(uint16_t sum, const uint8_t *data, uint16_t len)
+{
+    uint16_t t;
+    const uint8_t *dataptr;
+    const uint8_t *last_byte;
+
+    dataptr = data;
+    last_byte = data + len - 1;
+
+    while(dataptr < last_byte)
+    {
+        /* At least two more bytes */
+        t = (dataptr[0] << 8) + dataptr[1];
+        sum += t;
+        if (sum < t)
+        {
+            ++sum; /* Carry */
+        }
+        dataptr += 2;
+    }
+
+    if (dataptr == last_byte)
+    {
+        t = (dataptr[0] << 8) + 0;
+        sum += t;
+        if (sum < t)
+        {
+            ++sum; /* carry */
+        }
+    }
+    return sum;
+}
\ No newline at end of file
@@ -0,0 +1,272 @@
+#define ipaddr_len_c 16
+/** Number of passes of the radix sort: the prefix length plus one per byte */
+#define app_cidr_passes_c (ipaddr_len_c + 1)
+
+/** An IPv6 prefix as produced by app_pton(). */
+typedef struct app_cidr_tag
+{
+    /** Network number, the most significant byte in byte 0. */
+    uint8_t addr[ipaddr_len_c];
+    /** Length of the prefix in bits, in the range of [0, 128]. */
+    uint8_t bits;
+} app_cidr_t;
+
+/** Scratch memory of app_cidr_sort(), the byte histograms of all passes. */
+typedef struct app_cidr_hist_tag
+{
+    size_t count[app_cidr_passes_c][256];
+} app_cidr_hist_t;
+
+/**
+Sort prefixes by network number and then by prefix length with a least
+significant digit radix sort. All byte histograms are taken in one pass and
+passes where every prefix has the same digit are skipped, so long common
+leading bytes cost nothing.
+@param[in,out] list The prefixes to sort.
+@param[in] n The number of prefixes.
+@param[in] tmp Scratch memory for n prefixes, allocated by caller.
+@param[in] hist Scratch memory for the histograms, allocated by caller.
+@return True on success or false when scratch memory is missing, the list is
+then unchanged.
+*/
+bool app_cidr_sort(app_cidr_t * list, size_t n, app_cidr_t * tmp,
+                   app_cidr_hist_t * hist)
+{
+    size_t (* count)[256];
+    app_cidr_t * src = list;
+    app_cidr_t * dst = tmp;
+    app_cidr_t * swap;
+    size_t pos;
+    size_t c;
+    size_t i;
+    uint16_t d;
+    uint8_t pass;
+    uint8_t digit;
+
+    if (n < 2)
+    {
+        return true;
+    }
+    if ((NULL == tmp) || (NULL == hist))
+    {
+        return false;
+    }
+    count = hist->count;
+    memset(count, 0, sizeof(hist->count));
+
+    for (i = 0; i < n; ++i)
+    {
+        ++count[0][list[i].bits];
+        for (pass = 1; pass < app_cidr_passes_c; ++pass)
+        {
+            ++count[pass][list[i].addr[ipaddr_len_c - pass]];
+        }
+    }
+
+    for (pass = 0; pass < app_cidr_passes_c; ++pass)
+    {
+        digit = (0 == pass) ? src[0].bits : src[0].addr[ipaddr_len_c - pass];
+        if (count[pass][digit] == n)
+        {
+            continue;
+        }
+
+        pos = 0;
+        for (d = 0; d < 256; ++d)
+        {
+            c = count[pass][d];
+            count[pass][d] = pos;
+            pos += c;
+        }
+
+        for (i = 0; i < n; ++i)
+        {
+            digit = (0 == pass) ? src[i].bits : src[i].addr[ipaddr_len_c - pass];
+            dst[count[pass][digit]] = src[i];
+            ++count[pass][digit];
+        }
+
+        swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    if (src != list)
+    {
+        memcpy(list, src, n * sizeof(app_cidr_t));
+    }
+
+    return true;
+}
+
+/**
+Reduce a list of prefixes to the minimal set covering the same addresses.
+Host bits are cleared, prefixes covered by another one are removed and
+sibling prefixes are merged into their parent, repeatedly.
+@param[in,out] list The prefixes. The result is stored at the start of the
+list, sorted by network number.
+@param[in] n The number of prefixes.
+@param[in] tmp Scratch memory for n prefixes, allocated by caller.
+@param[in] hist Scratch memory for the histograms of the sort, allocated by
+caller.
+@return The number of prefixes in the result, 0 when scratch memory is
+missing.
+*/
+size_t app_cidr_aggregate(app_cidr_t * list, size_t n, app_cidr_t * tmp,
+                          app_cidr_hist_t * hist)
+{
+    size_t i;
+    size_t k = 0;
+
+    if ((NULL == tmp) || (NULL == hist))
+    {
+        return 0;
+    }
+
+    /* Drop invalid lengths and normalize so equal networks sort together. */
+    for (i = 0; i < n; ++i)
+    {
+        if (list[i].bits <= 128)
+        {
+            list[k] = list[i];
+            app_cidr_mask(list[k].addr, list[k].bits);
+            ++k;
+        }
+    }
+    n = k;
+
+    app_cidr_sort(list, n, tmp, hist);
+
+    /* The kept prefixes are disjoint and sorted, so a prefix covering the
+    next one can only be the last one kept. */
+    k = 0;
+    for (i = 0; i < n; ++i)
+    {
+        if ((k > 0) && (list[k - 1].bits <= list[i].bits) &&
+            app_cidr_prefix_equal(list[k - 1].addr, list[i].addr,
+                                  list[k - 1].bits))
+        {
+            continue;
+        }
+
+        list[k] = list[i];
+        ++k;
+
+        /* The lower sibling sorts first and its last bit is zero already. */
+        while ((k >= 2) && (list[k - 2].bits == list[k - 1].bits) &&
+               (list[k - 1].bits > 0) &&
+               app_cidr_prefix_equal(list[k - 2].addr, list[k - 1].addr,
+                                     list[k - 1].bits - 1))
+        {
+            --list[k - 2].bits;
+            --k;
+        }
+    }
+
+    return k;
+}
+
+/**
+Write prefixes in presentation format, one per line, with app_ntop(). Every
+address is printed in full and the prefix length appended, so the text reads
+back as the same networks.
+@param[in] list The prefixes.
+@param[in] n The number of prefixes.
+@param[out] dst The destination buffer.
+@param[in] size Size of the destination buffer.
+@param[out] used Number of bytes written to the destination buffer.
+@return The number of prefixes written. It is less than n when the buffer is
+full, the caller flushes the buffer and continues from there.
+*/
+size_t app_cidr_format(const app_cidr_t * list, size_t n,
+                       uint8_t * dst, size_t size, size_t * used)
+{
+    uint8_t line[sizeof("xxxx:xxxx:xxxx:xxxx:xxxx:xxxx:255.255.255.255/128")];
+    uint8_t addr[ipaddr_len_c];
+    uint8_t bits;
+    uint8_t len;
+    size_t pos = 0;
+    size_t i;
+
+    for (i = 0; i < n; ++i)
+    {
+        /* Given the prefix length app_ntop() prints only the words covering
+        it and compresses zeros within them, e.g. 2001:db8:0:0:1::/80 as
+        2001:db8::1/80, which reads back as another network. */
+        memcpy(addr, list[i].addr, ipaddr_len_c);
+        bits = list[i].bits;
+        len = (bits <= 128) ? app_ntop(addr, 128, line, sizeof(line)) : 0;
+        if ((0 != len) && (bits < 128))
+        {
+            line[len] = '/';
+            ++len;
+            if (bits >= 100)
+            {
+                line[len] = '1';
+                ++len;
+            }
+            if (bits >= 10)
+            {
+                line[len] = (uint8_t)('0' + (bits / 10) % 10);
+                ++len;
+            }
+            line[len] = (uint8_t)('0' + bits % 10);
+            ++len;
+        }
+        if ((0 == len) || (pos + len + 1 > size))
+        {
+            break;
+        }
+        memcpy(dst + pos, line, len);
+        pos += len;
+        dst[pos] = '\n';
+        ++pos;
+    }
+
+    *used = pos;
+    return i;
+}
+
+/**
+Clear the host bits of a network number.
+@param[in,out] addr The network number.
+@param[in] bits Length of the prefix in bits.
+*/
+static void app_cidr_mask(uint8_t * addr, uint8_t bits)
+{
+    uint8_t bytes = bits / 8;
+
+    if (bits < 128)
+    {
+        if (0 != (bits % 8))
+        {
+            addr[bytes] &= (uint8_t)(0xff << (8 - (bits % 8)));
+            ++bytes;
+        }
+        memset(addr + bytes, 0, ipaddr_len_c - bytes);
+    }
+}
+
+/**
+Compare the leading bits of two network numbers.
+@param[in] a The first network number.
+@param[in] b The second network number.
+@param[in] bits Number of leading bits to compare.
+@return True when the leading bits are equal or false otherwise.
+*/
+static bool app_cidr_prefix_equal(const uint8_t * a, const uint8_t * b,
+                                  uint8_t bits)
+{
+    uint8_t bytes = bits / 8;
+    uint8_t mask;
+    bool equal;
+
+    equal = (0 == memcmp(a, b, bytes));
+    if (equal && (0 != (bits % 8)))
+    {
+        mask = (uint8_t)(0xff << (8 - (bits % 8)));
+        equal = (0 == ((a[bytes] ^ b[bytes]) & mask));
+    }
+
+    return equal;
+}
\ No newline at end of file
@@ -0,0 +1,309 @@
+#define ipaddr_len_c 16
+/** Size of IPv6 header */
+#define IP_IPH_LEN    			40
+/** Types of Next header (Protocols) */
+#define IP_PROTO_ICMP6 	            58  /** ICMPv6 header */
+/** ICMPv6 message types, rfc 4443 section 4 */
+#define ICMP6_ECHO_REQUEST          128
+#define ICMP6_ECHO_REPLY            129
+/** Size of the ICMPv6 echo header: type, code, checksum, identifier and
+sequence number */
+#define ICMP6_ECHO_LEN              8
+/** Hop limit of the replies */
+#define app_echo_hop_limit_c        64
+
+/** IP address type. 0 for link local address, 1 for global address and 2 for
+ multicast address. The most significant byte is saved in byte 0. */
+typedef uint8_t ipaddr_t[ipaddr_len_c];
+
+/** The IPv6 header. */
+typedef struct ip_hdr_tag
+{
+    /** Version + Traffic class  */
+    uint8_t vtc;
+    /** Traffic class + Flow label */
+    uint8_t tcflow;
+    /** Flow label 16bits */
+    uint8_t flow[2];
+    /** Length of the IPv6 payload */
+    uint8_t len[2];
+    /** Type of header immediately following the IPv6 header. */
+    uint8_t proto;
+    /** Hop limit - Time to Live*/
+	uint8_t ttl;
+    /** 128-bit address of the originator of the packet. */
+    ipaddr_t srcaddr;
+    /** 128-bit address of the intended recipient of the packet */
+    ipaddr_t dstaddr;
+} ip_hdr_t;
+
+/** The ICMPv6 header. */
+typedef struct icmp_hdr_tag
+{
+    /** Type of ICMP message */
+    uint8_t type;
+    /** Code */
+    uint8_t code;
+    /** Checksum */
+    uint8_t chksum[2];
+} icmp_hdr_t;
+
+/** Counters of one burst handled by app_icmp_echo_burst(). */
+typedef struct app_echo_stats_tag
+{
+    /** Packets in the burst. */
+    uint16_t rx;
+    /** Requests turned into replies. */
+    uint16_t replied;
+    /** Dropped: not IPv6 or buffer shorter than the headers. */
+    uint16_t bad_len;
+    /** Dropped: next header is not ICMPv6. */
+    uint16_t bad_proto;
+    /** Dropped: not an echo request or code is not zero. */
+    uint16_t bad_type;
+    /** Dropped: source is unspecified or multicast. */
+    uint16_t bad_src;
+    /** Dropped: sent to multicast and no local address to reply from. */
+    uint16_t no_local;
+} app_echo_stats_t;
+
+/** Why a packet is not answered. */
+typedef enum app_echo_drop_tag
+{
+    app_echo_ok_c = 0,
+    app_echo_bad_len_c,
+    app_echo_bad_proto_c,
+    app_echo_bad_type_c,
+    app_echo_bad_src_c,
+    app_echo_no_local_c
+} app_echo_drop_t;
+
+/**
+Turn a burst of ICMPv6 echo requests into echo replies in place.
+Addresses are swapped, the type is rewritten and the checksum is updated
+incrementally from the one of the request according to rfc 1624, so the echo
+payload is never read. A request with a wrong checksum gives a reply with a
+wrong checksum, which the originator drops.
+@param[in,out] pkts The packets, each starting with its IPv6 header. On
+return the replies are at the front, in the order received.
+@param[in] lens The number of valid bytes of each packet.
+@param[in] n The number of packets.
+@param[in] local The address replies to multicast requests are sent from, or
+NULL to drop such requests.
+@param[out] dropped The packets dropped, in the order received. May be NULL.
+@param[out] stats The counters of this burst.
+@return The number of replies.
+*/
+uint16_t app_icmp_echo_burst(ip_hdr_t ** pkts, const uint16_t * lens,
+                             uint16_t n, const uint8_t * local,
+                             ip_hdr_t ** dropped, app_echo_stats_t * stats)
+{
+    ip_hdr_t * hdr;
+    icmp_hdr_t * icmp;
+    uint16_t chksum;
+    uint16_t replied = 0;
+    uint16_t drops = 0;
+    uint16_t i;
+    app_echo_drop_t reason;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->rx = n;
+
+    for (i = 0; i < n; ++i)
+    {
+        hdr = pkts[i];
+        if (i + 1 < n)
+        {
+            __builtin_prefetch(pkts[i + 1]);
+        }
+
+        reason = app_icmp_echo_check(hdr, lens[i], local);
+        if (app_echo_ok_c != reason)
+        {
+            app_icmp_echo_count(stats, reason);
+            if (NULL != dropped)
+            {
+                dropped[drops] = hdr;
+            }
+            ++drops;
+            continue;
+        }
+
+        icmp = (icmp_hdr_t *)((uint8_t *)hdr + IP_IPH_LEN);
+        chksum = (icmp->chksum[0] << 8) + icmp->chksum[1];
+
+        /* Type and code share the first word. */
+        chksum = app_chksum_adjust(chksum, (ICMP6_ECHO_REQUEST << 8) + 0,
+                                   (ICMP6_ECHO_REPLY << 8) + 0);
+        icmp->type = ICMP6_ECHO_REPLY;
+
+        /* The pseudo-header sums both addresses, so swapping them keeps the
+        checksum. Only replacing a multicast destination changes it. */
+        if (0xff == hdr->dstaddr[0])
+        {
+            chksum = app_chksum_adjust_addr(chksum, hdr->dstaddr, local);
+            memcpy(hdr->dstaddr, hdr->srcaddr, ipaddr_len_c);
+            memcpy(hdr->srcaddr, local, ipaddr_len_c);
+        }
+        else
+        {
+            app_icmp_echo_swap(hdr);
+        }
+        hdr->ttl = app_echo_hop_limit_c;
+
+        icmp->chksum[0] = (uint8_t)(chksum >> 8);
+        icmp->chksum[1] = (uint8_t)chksum;
+
+        pkts[replied] = hdr;
+        ++replied;
+    }
+
+    stats->replied = replied;
+    return replied;
+}
+
+/**
+Update a checksum when one 16-bit word of the covered data changes, according
+to rfc 1624 equation 3: HC' = ~(~HC + ~m + m').
+@param[in] chksum The checksum in host byte order.
+@param[in] old_word The old value of the word in host byte order.
+@param[in] new_word The new value of the word in host byte order.
+@return The updated checksum in host byte order.
+*/
+uint16_t app_chksum_adjust(uint16_t chksum, uint16_t old_word,
+                           uint16_t new_word)
+{
+    uint32_t sum;
+
+    sum = (uint16_t)~chksum;
+    sum += (uint16_t)~old_word;
+    sum += new_word;
+    sum = (sum & 0xffff) + (sum >> 16);
+    sum = (sum & 0xffff) + (sum >> 16);
+
+    return (uint16_t)~sum;
+}
+
+/**
+Update a checksum when an address covered by it is replaced.
+@param[in] chksum The checksum in host byte order.
+@param[in] old_addr The address being replaced.
+@param[in] new_addr The new address.
+@return The updated checksum in host byte order.
+*/
+static uint16_t app_chksum_adjust_addr(uint16_t chksum,
+                                       const uint8_t * old_addr,
+                                       const uint8_t * new_addr)
+{
+    uint8_t i;
+
+    for (i = 0; i < ipaddr_len_c; i += 2)
+    {
+        chksum = app_chksum_adjust(chksum,
+                                   (old_addr[i] << 8) + old_addr[i + 1],
+                                   (new_addr[i] << 8) + new_addr[i + 1]);
+    }
+
+    return chksum;
+}
+
+/**
+Check whether a packet is an echo request that can be answered.
+@param[in] hdr The ip header of the packet.
+@param[in] len The number of valid bytes of the packet.
+@param[in] local The address to answer multicast requests from or NULL.
+@return app_echo_ok_c when the packet can be answered or the reason to drop it.
+*/
+static app_echo_drop_t app_icmp_echo_check(const ip_hdr_t * hdr,
+                                           uint16_t len,
+                                           const uint8_t * local)
+{
+    const icmp_hdr_t * icmp;
+    uint16_t upper_layer_len;
+    uint8_t i;
+    uint8_t any = 0;
+
+    if ((len < IP_IPH_LEN + ICMP6_ECHO_LEN) || (0x60 != (hdr->vtc & 0xf0)))
+    {
+        return app_echo_bad_len_c;
+    }
+
+    upper_layer_len = ((hdr->len[0]) << 8) + hdr->len[1];
+    if ((upper_layer_len < ICMP6_ECHO_LEN) ||
+        (upper_layer_len > len - IP_IPH_LEN))
+    {
+        return app_echo_bad_len_c;
+    }
+
+    if (IP_PROTO_ICMP6 != hdr->proto)
+    {
+        return app_echo_bad_proto_c;
+    }
+
+    icmp = (const icmp_hdr_t *)((const uint8_t *)hdr + IP_IPH_LEN);
+    if ((ICMP6_ECHO_REQUEST != icmp->type) || (0 != icmp->code))
+    {
+        return app_echo_bad_type_c;
+    }
+
+    for (i = 0; i < ipaddr_len_c; ++i)
+    {
+        any |= hdr->srcaddr[i];
+    }
+    if ((0 == any) || (0xff == hdr->srcaddr[0]))
+    {
+        return app_echo_bad_src_c;
+    }
+
+    if ((0xff == hdr->dstaddr[0]) && (NULL == local))
+    {
+        return app_echo_no_local_c;
+    }
+
+    return app_echo_ok_c;
+}
+
+/**
+Count a dropped packet.
+@param[in,out] stats The counters of the burst.
+@param[in] reason The reason of the drop.
+*/
+static void app_icmp_echo_count(app_echo_stats_t * stats,
+                                app_echo_drop_t reason)
+{
+    switch (reason)
+    {
+    case app_echo_bad_len_c:
+        ++stats->bad_len;
+        break;
+    case app_echo_bad_proto_c:
+        ++stats->bad_proto;
+        break;
+    case app_echo_bad_type_c:
+        ++stats->bad_type;
+        break;
+    case app_echo_bad_src_c:
+        ++stats->bad_src;
+        break;
+    case app_echo_no_local_c:
+        ++stats->no_local;
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+Swap the source and destination addresses of a packet.
+@param[in,out] hdr The ip header of the packet.
+*/
+static void app_icmp_echo_swap(ip_hdr_t * hdr)
+{
+    uint64_t s[2];
+    uint64_t d[2];
+
+    memcpy(s, hdr->srcaddr, ipaddr_len_c);
+    memcpy(d, hdr->dstaddr, ipaddr_len_c);
+    memcpy(hdr->srcaddr, d, ipaddr_len_c);
+    memcpy(hdr->dstaddr, s, ipaddr_len_c);
+}
\ No newline at end of file
@@ -0,0 +1,415 @@
+#define ipaddr_len_c 16
+
+/** Number of shards, writers to different shards do not contend. */
+#define app_intern_shards_c 16
+/** Addresses per page of the reverse table, as a power of 2. */
+#define app_intern_page_bits_c 12
+#define app_intern_page_c (1u << app_intern_page_bits_c)
+/** ID returned when an address could not be interned. */
+#define app_intern_none_c 0xFFFFFFFFu
+
+/** IP address type. 0 for link local address, 1 for global address and 2 for
+ multicast address. The most significant byte is saved in byte 0. */
+typedef uint8_t ipaddr_t[ipaddr_len_c];
+
+/** The IPv6 header. */
+typedef struct ip_hdr_tag
+{
+    /** Version + Traffic class  */
+    uint8_t vtc;
+    /** Traffic class + Flow label */
+    uint8_t tcflow;
+    /** Flow label 16bits */
+    uint8_t flow[2];
+    /** Length of the IPv6 payload */
+    uint8_t len[2];
+    /** Type of header immediately following the IPv6 header. */
+    uint8_t proto;
+    /** Hop limit - Time to Live*/
+    uint8_t ttl;
+    /** 128-bit address of the originator of the packet. */
+    ipaddr_t srcaddr;
+    /** 128-bit address of the intended recipient of the packet */
+    ipaddr_t dstaddr;
+} ip_hdr_t;
+
+/** One shard of the address to ID hash table, open addressing with linear
+probing. A slot holds ID + 1, 0 when empty. Slots are written once, under the
+lock, and read without it. The fields read by lookups and the fields written
+by inserts are on separate cache lines, so inserts do not evict the line every
+lookup reads. */
+typedef struct app_intern_shard_tag
+{
+    /** Number of slots minus one. */
+    _Alignas(64) uint32_t mask;
+    _Atomic uint32_t * slots;
+    _Alignas(64) pthread_mutex_t lock;
+    /** Number of used slots. */
+    uint32_t count;
+} app_intern_shard_t;
+
+/** Dictionary mapping IPv6 addresses to dense 32-bit IDs and back. */
+typedef struct app_intern_tag
+{
+    app_intern_shard_t shards[app_intern_shards_c];
+    /** Next ID to hand out. */
+    _Alignas(64) _Atomic uint32_t next_id;
+    /** Maximum number of addresses. */
+    uint32_t capacity;
+    /** Number of pages of the reverse table. */
+    uint32_t pages_cnt;
+    /** Reverse table, ID to address, allocated a page at a time. */
+    _Atomic(ipaddr_t *) * pages;
+} app_intern_t;
+
+/**
+Create a dictionary. Every shard gets slots for twice its share of capacity
+and takes up to 3/4 of them, so with evenly hashing addresses the dictionary
+fills up at capacity. Addresses that hash very unevenly may fill a shard
+earlier, see app_intern().
+@param[out] dict The dictionary.
+@param[in] capacity Maximum number of different addresses.
+@return True on success or false otherwise.
+*/
+bool app_intern_init(app_intern_t * dict, uint32_t capacity)
+{
+    uint32_t slots = 16;
+    uint8_t i;
+    bool ret = true;
+
+    memset(dict, 0, sizeof(*dict));
+    if ((0 == capacity) || (capacity >= app_intern_none_c))
+    {
+        return false;
+    }
+
+    /* Load factor at most 1/2 on average, 3/4 in the fullest shard. */
+    while (slots < capacity / app_intern_shards_c * 2 + 64)
+    {
+        slots <<= 1;
+    }
+
+    dict->capacity = capacity;
+    dict->pages_cnt = (capacity + app_intern_page_c - 1) >>
+                      app_intern_page_bits_c;
+    dict->pages = calloc(dict->pages_cnt, sizeof(*dict->pages));
+    ret = (NULL != dict->pages);
+
+    for (i = 0; ret && (i < app_intern_shards_c); ++i)
+    {
+        pthread_mutex_init(&dict->shards[i].lock, NULL);
+        dict->shards[i].mask = slots - 1;
+        dict->shards[i].slots = calloc(slots, sizeof(_Atomic uint32_t));
+        ret = (NULL != dict->shards[i].slots);
+    }
+
+    if (!ret)
+    {
+        app_intern_free(dict);
+    }
+
+    return ret;
+}
+
+/**
+Release the memory of a dictionary.
+@param[in] dict The dictionary.
+*/
+void app_intern_free(app_intern_t * dict)
+{
+    uint32_t i;
+
+    for (i = 0; i < app_intern_shards_c; ++i)
+    {
+        if (NULL != dict->shards[i].slots)
+        {
+            pthread_mutex_destroy(&dict->shards[i].lock);
+            free(dict->shards[i].slots);
+            dict->shards[i].slots = NULL;
+        }
+    }
+    for (i = 0; (NULL != dict->pages) && (i < dict->pages_cnt); ++i)
+    {
+        free(atomic_load_explicit(&dict->pages[i], memory_order_relaxed));
+    }
+    free(dict->pages);
+    dict->pages = NULL;
+}
+
+/**
+Find the ID of an address without interning it. Lock-free.
+@param[in] dict The dictionary.
+@param[in] addr The address.
+@return The ID or app_intern_none_c when the address is not interned.
+*/
+uint32_t app_intern_lookup(app_intern_t * dict, const uint8_t * addr)
+{
+    uint64_t hash = app_intern_hash(addr);
+
+    return app_intern_probe(dict, &dict->shards[hash >> 60], hash, addr,
+                            NULL);
+}
+
+/**
+Get the ID of an address, interning it on first sight. Lookups of interned
+addresses take no lock, new addresses lock one shard.
+@param[in] dict The dictionary.
+@param[in] addr The address.
+@return The ID or app_intern_none_c when the dictionary holds capacity
+addresses, the shard of the address is 3/4 full or memory is short.
+*/
+uint32_t app_intern(app_intern_t * dict, const uint8_t * addr)
+{
+    uint64_t hash = app_intern_hash(addr);
+    app_intern_shard_t * shard = &dict->shards[hash >> 60];
+    uint32_t slot;
+    uint32_t id;
+
+    id = app_intern_probe(dict, shard, hash, addr, NULL);
+    if (app_intern_none_c != id)
+    {
+        return id;
+    }
+
+    pthread_mutex_lock(&shard->lock);
+
+    /* Another writer may have added it meanwhile. */
+    id = app_intern_probe(dict, shard, hash, addr, &slot);
+    if ((app_intern_none_c == id) &&
+        ((shard->count + 1) * 4 <= (shard->mask + 1) * 3))
+    {
+        id = app_intern_store(dict, addr);
+        if (app_intern_none_c != id)
+        {
+            ++shard->count;
+            /* Publish after the address is in the reverse table. */
+            atomic_store_explicit(&shard->slots[slot], id + 1,
+                                  memory_order_release);
+        }
+    }
+
+    pthread_mutex_unlock(&shard->lock);
+    return id;
+}
+
+/**
+Intern the source and destination addresses of a burst of packets.
+@param[in] dict The dictionary.
+@param[in] hdrs The ip headers of the packets.
+@param[in] n The number of packets.
+@param[out] src_ids The IDs of the source addresses.
+@param[out] dst_ids The IDs of the destination addresses.
+@return The number of packets whose addresses were both interned. The IDs of
+the others are app_intern_none_c.
+*/
+uint16_t app_intern_burst(app_intern_t * dict, ip_hdr_t * const * hdrs,
+                          uint16_t n, uint32_t * src_ids, uint32_t * dst_ids)
+{
+    uint64_t hash[2];
+    uint16_t ok = 0;
+    uint16_t i;
+
+    for (i = 0; i < n; ++i)
+    {
+        /* Hash ahead and touch the slots the next packet will probe. */
+        if (i + 1 < n)
+        {
+            hash[0] = app_intern_hash(hdrs[i + 1]->srcaddr);
+            hash[1] = app_intern_hash(hdrs[i + 1]->dstaddr);
+            __builtin_prefetch(&dict->shards[hash[0] >> 60].slots[
+                                   hash[0] & dict->shards[hash[0] >> 60].mask]);
+            __builtin_prefetch(&dict->shards[hash[1] >> 60].slots[
+                                   hash[1] & dict->shards[hash[1] >> 60].mask]);
+        }
+
+        src_ids[i] = app_intern(dict, hdrs[i]->srcaddr);
+        dst_ids[i] = app_intern(dict, hdrs[i]->dstaddr);
+        if ((app_intern_none_c != src_ids[i]) &&
+            (app_intern_none_c != dst_ids[i]))
+        {
+            ++ok;
+        }
+    }
+
+    return ok;
+}
+
+/**
+Get the address of an ID. Lock-free.
+@param[in] dict The dictionary.
+@param[in] id An ID returned by the dictionary.
+@return The address, valid until the dictionary is freed, or NULL when the ID
+is unknown.
+*/
+const uint8_t * app_intern_addr(app_intern_t * dict, uint32_t id)
+{
+    ipaddr_t * page = NULL;
+
+    if (id < atomic_load_explicit(&dict->next_id, memory_order_acquire))
+    {
+        page = atomic_load_explicit(
+                   &dict->pages[id >> app_intern_page_bits_c],
+                   memory_order_acquire);
+    }
+
+    return (NULL != page) ? page[id & (app_intern_page_c - 1)] : NULL;
+}
+
+/**
+Convert the address of an ID to presentation format with app_ntop().
+@param[in] dict The dictionary.
+@param[in] id An ID returned by the dictionary.
+@param[out] dst The destination of the presentation output.
+@param[in] size Size of the destination buffer.
+@return Length of the string written to the destination buffer in bytes, 0
+when the ID is unknown or the buffer is too small.
+*/
+uint8_t app_intern_ntop(app_intern_t * dict, uint32_t id,
+                        uint8_t * dst, uint8_t size)
+{
+    const uint8_t * addr = app_intern_addr(dict, id);
+    uint8_t buf[ipaddr_len_c];
+    uint8_t len = 0;
+
+    if (NULL != addr)
+    {
+        memcpy(buf, addr, ipaddr_len_c);
+        len = app_ntop(buf, 128, dst, size);
+    }
+
+    return len;
+}
+
+/**
+Hash an address. The top 4 bits select the shard, the low bits the slot.
+@param[in] addr The address.
+@return The hash value.
+*/
+static uint64_t app_intern_hash(const uint8_t * addr)
+{
+    uint64_t lo;
+    uint64_t hi;
+    uint64_t h;
+
+    memcpy(&hi, addr, 8);
+    memcpy(&lo, addr + 8, 8);
+
+    h = (lo ^ 0x9E3779B97F4A7C15ull) * 0xBF58476D1CE4E5B9ull;
+    h ^= hi;
+    h *= 0x94D049BB133111EBull;
+    h ^= h >> 31;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 29;
+
+    return h;
+}
+
+/**
+Look an address up in a shard.
+@param[in] dict The dictionary.
+@param[in] shard The shard of the address.
+@param[in] hash The hash of the address.
+@param[in] addr The address.
+@param[out] free_slot The empty slot ending the probe, when not NULL.
+@return The ID or app_intern_none_c when the address is not found.
+*/
+static uint32_t app_intern_probe(app_intern_t * dict,
+                                 app_intern_shard_t * shard, uint64_t hash,
+                                 const uint8_t * addr, uint32_t * free_slot)
+{
+    uint32_t idx = (uint32_t) hash & shard->mask;
+    uint32_t val;
+    uint32_t id = app_intern_none_c;
+
+    for (;;)
+    {
+        val = atomic_load_explicit(&shard->slots[idx], memory_order_acquire);
+        if (0 == val)
+        {
+            if (NULL != free_slot)
+            {
+                *free_slot = idx;
+            }
+            break;
+        }
+        if (0 == memcmp(app_intern_addr(dict, val - 1), addr, ipaddr_len_c))
+        {
+            id = val - 1;
+            break;
+        }
+        idx = (idx + 1) & shard->mask;
+    }
+
+    return id;
+}
+
+/**
+Append an address to the reverse table. The page of an ID is allocated before
+the ID is taken, so IDs stay dense when memory is short.
+@param[in] dict The dictionary.
+@param[in] addr The address.
+@return The new ID or app_intern_none_c when the dictionary is full or memory
+is short.
+*/
+static uint32_t app_intern_store(app_intern_t * dict, const uint8_t * addr)
+{
+    ipaddr_t * page;
+    uint32_t id;
+
+    id = atomic_load_explicit(&dict->next_id, memory_order_relaxed);
+    do
+    {
+        if (id >= dict->capacity)
+        {
+            return app_intern_none_c;
+        }
+        page = app_intern_page(dict, id);
+        if (NULL == page)
+        {
+            return app_intern_none_c;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&dict->next_id, &id,
+                                                    id + 1,
+                                                    memory_order_relaxed,
+                                                    memory_order_relaxed));
+
+    memcpy(page[id & (app_intern_page_c - 1)], addr, ipaddr_len_c);
+    return id;
+}
+
+/**
+Get the page of the reverse table holding an ID, allocating it if needed.
+Pages are never freed before the dictionary is.
+@param[in] dict The dictionary.
+@param[in] id The ID.
+@return The page or NULL when out of memory.
+*/
+static ipaddr_t * app_intern_page(app_intern_t * dict, uint32_t id)
+{
+    _Atomic(ipaddr_t *) * slot = &dict->pages[id >> app_intern_page_bits_c];
+    ipaddr_t * page;
+    ipaddr_t * fresh;
+
+    page = atomic_load_explicit(slot, memory_order_acquire);
+    if (NULL == page)
+    {
+        /* Writers of other shards may race for the same page. */
+        fresh = malloc(app_intern_page_c * sizeof(ipaddr_t));
+        if (NULL == fresh)
+        {
+            return NULL;
+        }
+        if (atomic_compare_exchange_strong_explicit(slot, &page, fresh,
+                                                    memory_order_acq_rel,
+                                                    memory_order_acquire))
+        {
+            page = fresh;
+        }
+        else
+        {
+            free(fresh);
+        }
+    }
+
+    return page;
+}
\ No newline at end of file
@@ -1,3 +1,5 @@
+#include "app-instrument.h"
+
 #define ipaddr_len_c 16
 
 /**
@@ -26,6 +28,7 @@ uint8_t app_ntop(uint8_t * src, uint8_t bits, uint8_t * dst, uint8_t size)
     bool is_ipv4 = false;
     uint8_t * dp;
     uint8_t len = 0;
+    APP_INSTR_BEGIN();
 
     if (bits <= 128)
     {
@@ -67,8 +70,17 @@ uint8_t app_ntop(uint8_t * src, uint8_t bits, uint8_t * dst, uint8_t size)
             strcpy(dst, outbuf);
             len = strlen(outbuf);
         }
+        else
+        {
+            APP_INSTR_FAIL(app_instr_fail_ntop_size_c);
+        }
        }
+    else
+    {
+        APP_INSTR_FAIL(app_instr_fail_ntop_bits_c);
+    }
 
+    APP_INSTR_END(app_instr_ntop_c, len);
     return len;
 }
 
@@ -106,8 +118,9 @@ static uint8_t app_ntop_longest_zeros(uint8_t * src,
             {
                 best_pos = cur_pos;
                 best_len = cur_len;
-                cur_len = 0;
             }
+            /* A shorter run ends here too, or it joins the next one. */
+            cur_len = 0;
         }
     }
 
@@ -173,6 +186,7 @@ static uint8_t app_ntop_format(uint8_t * src, uint8_t words, uint8_t bits,
 {
     uint8_t i;
     uint8_t * dp = dst;
+    APP_INSTR_BEGIN();
 
     for (i = 0; i < words; ++i)
     {
@@ -228,5 +242,6 @@ static uint8_t app_ntop_format(uint8_t * src, uint8_t words, uint8_t bits,
     {
         *dp = '\0';
     }
+    APP_INSTR_END(app_instr_ntop_format_c, strlen(dst));
     return strlen(dst);
 }
\ No newline at end of file
@@ -0,0 +1,332 @@
+#ifndef IPV6_P_TO_N_CONSTEVAL_HPP
+#define IPV6_P_TO_N_CONSTEVAL_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/**
+Compile time counterpart of app_pton() for IPv6 literals in static tables.
+The grammar is the one of app_pton_ipv6() and app_pton_v4(): hex words, one
+"::", an embedded IPv4 address in the last 32 bits and an optional "/prefix".
+Host bits are cleared as app_pton() does. The parser is stricter where
+app_pton() is lenient: an address without "::" must have all 8 words, a
+trailing single ':' is refused, the prefix must be decimal in [1, 128] and
+every IPv4 character must be a digit or a dot.
+A literal that does not parse is a compile error, the compiler diagnostic
+points to the app_pton_literal_error_*() function naming the reason.
+*/
+
+/** Network number and prefix length, the result of app_pton_literal(). */
+struct app_ipv6_prefix_t
+{
+    /** Network number, the most significant byte in byte 0. */
+    std::array<uint8_t, 16> addr;
+    /** Length of the prefix in bits. 128 when there is no prefix. */
+    uint8_t bits;
+};
+
+/* Not constexpr on purpose: calling one during constant evaluation stops the
+compilation and the function name tells why. */
+void app_pton_literal_error_bad_character();
+void app_pton_literal_error_too_many_words();
+void app_pton_literal_error_word_too_long();
+void app_pton_literal_error_double_colon();
+void app_pton_literal_error_trailing_colon();
+void app_pton_literal_error_too_few_words();
+void app_pton_literal_error_bad_ipv4();
+void app_pton_literal_error_bad_prefix();
+
+namespace app_pton_detail
+{
+
+/**
+Parse a decimal prefix length.
+@param[in] src The characters after '/'.
+@return The length of the prefix in bits.
+*/
+consteval uint8_t prefix(std::string_view src)
+{
+    uint16_t val = 0;
+
+    if (src.empty() || (src.size() > 3) || (src[0] == '0'))
+    {
+        app_pton_literal_error_bad_prefix();
+    }
+    for (char ch : src)
+    {
+        if ((ch < '0') || (ch > '9'))
+        {
+            app_pton_literal_error_bad_prefix();
+        }
+        val = val * 10 + (ch - '0');
+    }
+    if (val > 128)
+    {
+        app_pton_literal_error_bad_prefix();
+    }
+
+    return static_cast<uint8_t>(val);
+}
+
+/**
+Parse an embedded IPv4 address, see app_pton_v4().
+@param[in] src The IPv4 presentation, possibly followed by "/prefix".
+@param[out] dst The destination of the 4 bytes.
+@return The length of the prefix in bits, 128 when there is no prefix.
+*/
+consteval uint8_t v4(std::string_view src, uint8_t * dst)
+{
+    uint8_t octets = 0;
+    uint8_t digits = 0;
+    uint16_t val = 0;
+    uint8_t bits = 128;
+    std::size_t i;
+
+    for (i = 0; i < src.size(); ++i)
+    {
+        char ch = src[i];
+        if (ch == '.')
+        {
+            if ((digits == 0) || (octets == 3))
+            {
+                app_pton_literal_error_bad_ipv4();
+            }
+            dst[octets++] = static_cast<uint8_t>(val);
+            val = 0;
+            digits = 0;
+        }
+        else if (ch == '/')
+        {
+            bits = prefix(src.substr(i + 1));
+            break;
+        }
+        else if ((ch >= '0') && (ch <= '9'))
+        {
+            /* No leading zeros, as in app_pton_v4(). */
+            if ((digits != 0) && (val == 0))
+            {
+                app_pton_literal_error_bad_ipv4();
+            }
+            ++digits;
+            val = val * 10 + (ch - '0');
+            if (val > 255)
+            {
+                app_pton_literal_error_bad_ipv4();
+            }
+        }
+        else
+        {
+            app_pton_literal_error_bad_ipv4();
+        }
+    }
+
+    if ((octets != 3) || (digits == 0))
+    {
+        app_pton_literal_error_bad_ipv4();
+    }
+    dst[octets] = static_cast<uint8_t>(val);
+
+    return bits;
+}
+
+/**
+Value of a hex digit.
+@param[in] ch The character.
+@return The value in [0, 15] or -1 when ch is not a hex digit.
+*/
+consteval int8_t xdigit(char ch)
+{
+    int8_t val = -1;
+
+    if ((ch >= '0') && (ch <= '9'))
+    {
+        val = static_cast<int8_t>(ch - '0');
+    }
+    else if ((ch >= 'a') && (ch <= 'f'))
+    {
+        val = static_cast<int8_t>(ch - 'a' + 10);
+    }
+    else if ((ch >= 'A') && (ch <= 'F'))
+    {
+        val = static_cast<int8_t>(ch - 'A' + 10);
+    }
+
+    return val;
+}
+
+} // namespace app_pton_detail
+
+/**
+Convert an IPv6 presentation to a network number at compile time.
+@param[in] src The IPv6 presentation, optionally with "/prefix".
+@return The network number and the length of the prefix.
+*/
+consteval app_ipv6_prefix_t app_pton_literal(std::string_view src)
+{
+    app_ipv6_prefix_t out{};
+    uint8_t buf[16] = {};
+    std::size_t tp = 0;
+    std::size_t colonp = 0;
+    std::size_t curtok = 0;
+    std::size_t sp = 0;
+    bool saw_xdigit = false;
+    bool saw_v4 = false;
+    bool saw_dcolon = false;
+    uint16_t val = 0;
+    uint8_t digits = 0;
+    uint8_t bits = 128;
+    uint8_t bytes;
+    std::size_t n;
+    std::size_t i;
+
+    /* Leading :: requires some special handling. */
+    if (src.size() < 2)
+    {
+        app_pton_literal_error_too_few_words();
+    }
+    if (src[0] == ':')
+    {
+        if (src[1] != ':')
+        {
+            app_pton_literal_error_double_colon();
+        }
+        ++sp;
+        curtok = sp;
+    }
+
+    for (; sp < src.size(); ++sp)
+    {
+        char ch = src[sp];
+        if (ch == ':')
+        {
+            if (saw_xdigit)
+            {
+                if (tp + 2 > 16)
+                {
+                    app_pton_literal_error_too_many_words();
+                }
+                buf[tp++] = static_cast<uint8_t>(val >> 8);
+                buf[tp++] = static_cast<uint8_t>(val);
+                saw_xdigit = false;
+            }
+            else if (!saw_dcolon)
+            {
+                /* "::" stands for at least one word. */
+                if (tp == 16)
+                {
+                    app_pton_literal_error_too_many_words();
+                }
+                colonp = tp;
+                saw_dcolon = true;
+            }
+            else
+            {
+                app_pton_literal_error_double_colon();
+            }
+            curtok = sp + 1;
+            digits = 0;
+            val = 0;
+        }
+        else if (ch == '.')
+        {
+            if (tp + 4 > 16)
+            {
+                app_pton_literal_error_too_many_words();
+            }
+            bits = app_pton_detail::v4(src.substr(curtok), buf + tp);
+            tp += 4;
+            saw_xdigit = false;
+            saw_v4 = true;
+            break;
+        }
+        else if (ch == '/')
+        {
+            bits = app_pton_detail::prefix(src.substr(sp + 1));
+            break;
+        }
+        else if (app_pton_detail::xdigit(ch) >= 0)
+        {
+            if (++digits > 4)
+            {
+                app_pton_literal_error_word_too_long();
+            }
+            val = static_cast<uint16_t>((val << 4) |
+                                        app_pton_detail::xdigit(ch));
+            saw_xdigit = true;
+        }
+        else
+        {
+            app_pton_literal_error_bad_character();
+        }
+    }
+
+    if (saw_xdigit)
+    {
+        if (tp + 2 > 16)
+        {
+            app_pton_literal_error_too_many_words();
+        }
+        buf[tp++] = static_cast<uint8_t>(val >> 8);
+        buf[tp++] = static_cast<uint8_t>(val);
+    }
+    else if (!saw_v4 && (curtok == sp) && !(saw_dcolon && (colonp == tp)))
+    {
+        /* Ends with a single ':' that is not part of "::". */
+        app_pton_literal_error_trailing_colon();
+    }
+
+    if (saw_dcolon)
+    {
+        if (tp == 16)
+        {
+            app_pton_literal_error_too_many_words();
+        }
+        n = tp - colonp;
+        for (i = 1; i <= n; ++i)
+        {
+            buf[16 - i] = buf[colonp + n - i];
+            buf[colonp + n - i] = 0;
+        }
+    }
+    else if (tp != 16)
+    {
+        app_pton_literal_error_too_few_words();
+    }
+
+    /* Apply bits */
+    if (bits < 128)
+    {
+        bytes = static_cast<uint8_t>((bits + 7) / 8);
+        for (i = bytes; i < 16; ++i)
+        {
+            buf[i] = 0;
+        }
+        if ((bits % 8) != 0)
+        {
+            buf[bytes - 1] &= static_cast<uint8_t>(0xff << (8 - (bits % 8)));
+        }
+    }
+
+    for (i = 0; i < 16; ++i)
+    {
+        out.addr[i] = buf[i];
+    }
+    out.bits = bits;
+
+    return out;
+}
+
+/**
+User defined literal for app_pton_literal(), "2001:db8::/32"_ip6.
+@param[in] src The IPv6 presentation.
+@param[in] size Length of the presentation.
+@return The network number and the length of the prefix.
+*/
+consteval app_ipv6_prefix_t operator""_ip6(const char * src, std::size_t size)
+{
+    return app_pton_literal(std::string_view(src, size));
+}
+
+#endif
\ No newline at end of file
@@ -1,3 +1,5 @@
+#include "app-instrument.h"
+
 #define ipaddr_len_c 16
 
 /**
@@ -18,12 +20,14 @@ uint8_t app_pton(uint8_t * src, uint8_t size, uint8_t * dst)
     uint16_t n;
     uint8_t bytes;
     uint8_t i;
+    APP_INSTR_BEGIN();
 
     sp = src;
     /* There are at least two charaters for a valid IPv6 address. */
     if (size < 2)
     {
         bits = 0;
+        APP_INSTR_FAIL(app_instr_fail_pton_short_c);
     }
     /* Leading :: requires some special handling. */
     else if (':' == *sp)
@@ -32,6 +36,7 @@ uint8_t app_pton(uint8_t * src, uint8_t size, uint8_t * dst)
         if (':' != *sp)
         {
             bits = 0;
+            APP_INSTR_FAIL(app_instr_fail_pton_colon_c);
         }
     }
 
@@ -42,6 +47,10 @@ uint8_t app_pton(uint8_t * src, uint8_t size, uint8_t * dst)
         memset(tp, '\0', ipaddr_len_c);
         colonp = NULL;
         bits = app_pton_ipv6(sp, size - (sp - src), &tp, endp, &colonp);
+        if (0 == bits)
+        {
+            APP_INSTR_FAIL(app_instr_fail_pton_syntax_c);
+        }
     }
 
     if (0 != bits)
@@ -71,6 +80,7 @@ uint8_t app_pton(uint8_t * src, uint8_t size, uint8_t * dst)
         memcpy(dst, outbuf, ipaddr_len_c);
     }
 
+    APP_INSTR_END(app_instr_pton_c, size);
     return (bits);
 }
 
@@ -100,6 +110,7 @@ static uint8_t app_pton_ipv6(
     const uint8_t * pch;
     uint8_t i;
     uint8_t bits = 128;
+    APP_INSTR_BEGIN();
 
     curtok = sp;
     saw_xdigit = false;
@@ -213,6 +224,7 @@ static uint8_t app_pton_ipv6(
         }
     }
 
+    APP_INSTR_END(app_instr_pton_ipv6_c, size);
     return bits;
 }
 
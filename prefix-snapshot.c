@@ -0,0 +1,499 @@
+#define ipaddr_len_c 16
+/** Number of passes of the radix sort: the prefix length plus one per byte */
+#define app_cidr_passes_c (ipaddr_len_c + 1)
+
+/** Magic bytes at the start of a snapshot file. */
+#define app_snap_magic_c "APPSNAP"
+/** Version of the snapshot format. */
+#define app_snap_version_c 1
+/** Size of the header, the keys start right after it. */
+#define app_snap_hdr_len_c 64
+
+/** An IPv6 prefix as produced by app_pton(). */
+typedef struct app_cidr_tag
+{
+    /** Network number, the most significant byte in byte 0. */
+    uint8_t addr[ipaddr_len_c];
+    /** Length of the prefix in bits, in the range of [0, 128]. */
+    uint8_t bits;
+} app_cidr_t;
+
+/** Scratch memory of app_cidr_sort(), see cidr-aggregate.c. */
+typedef struct app_cidr_hist_tag
+{
+    size_t count[app_cidr_passes_c][256];
+} app_cidr_hist_t;
+
+/** Header of a snapshot file. Numbers are in host byte order, a host of the
+other byte order sees a bad version. The file continues with count + 1 network
+numbers and then count + 1 prefix lengths padded to 8 bytes, both in Eytzinger
+order starting at index 1. Index 0 is unused so the 4 grandchildren of a
+network number share a cache line. */
+typedef struct app_snap_hdr_tag
+{
+    uint8_t magic[8];
+    uint16_t version;
+    /** Size of the header in bytes. */
+    uint16_t hdr_len;
+    uint32_t reserved;
+    /** Number of prefixes. */
+    uint64_t count;
+    /** Checksum of everything after the header. */
+    uint64_t data_sum;
+    /** Bit i is set when some prefix is i bits long. */
+    uint8_t lens[17];
+    uint8_t pad[7];
+    /** Checksum of the header up to this field. */
+    uint64_t hdr_sum;
+} app_snap_hdr_t;
+
+/** A snapshot mapped read-only. */
+typedef struct app_snap_tag
+{
+    /** The mapping of the whole file. */
+    const uint8_t * map;
+    size_t size;
+    const app_snap_hdr_t * hdr;
+    /** Network numbers, in Eytzinger order from index 1. */
+    const uint8_t (* keys)[ipaddr_len_c];
+    /** Prefix lengths, in the order of the network numbers. */
+    const uint8_t * bits;
+    /** Number of prefixes. */
+    size_t n;
+} app_snap_t;
+
+/**
+Write a set of prefixes as a snapshot file. The file is written under a unique
+temporary name next to path and renamed over path, so processes that have the
+old snapshot mapped keep a consistent view and concurrent writers do not
+overwrite each other's data. The file gets the permissions open() would give
+it under the process umask, and it and its directory are synced before
+returning, so a crash leaves either the old or the new snapshot.
+@param[in] path The path of the snapshot file.
+@param[in,out] list The prefixes. Host bits are cleared and the list is sorted.
+@param[in] n The number of prefixes.
+@param[in] tmp Scratch memory for n prefixes, allocated by caller.
+@param[in] hist Scratch memory for the histograms of the sort, allocated by
+caller.
+@return True on success or false otherwise.
+*/
+bool app_snap_write(const char * path, app_cidr_t * list, size_t n,
+                    app_cidr_t * tmp, app_cidr_hist_t * hist)
+{
+    app_snap_hdr_t * hdr;
+    uint8_t * map;
+    char * tmp_path;
+    size_t size;
+    size_t keys_len;
+    size_t i;
+    size_t k = 0;
+    bool ret = false;
+    int fd;
+
+    /* Drop invalid lengths and duplicates, as the search needs unique keys. */
+    for (i = 0; i < n; ++i)
+    {
+        if (list[i].bits <= 128)
+        {
+            list[k] = list[i];
+            app_snap_mask(list[k].addr, list[k].bits);
+            ++k;
+        }
+    }
+    /* The search needs sorted keys, never write an unsorted snapshot. */
+    if (!app_cidr_sort(list, k, tmp, hist))
+    {
+        return false;
+    }
+    n = k;
+    k = 0;
+    for (i = 0; i < n; ++i)
+    {
+        if ((0 == k) || (list[k - 1].bits != list[i].bits) ||
+            (0 != memcmp(list[k - 1].addr, list[i].addr, ipaddr_len_c)))
+        {
+            list[k] = list[i];
+            ++k;
+        }
+    }
+    n = k;
+
+    keys_len = (n + 1) * ipaddr_len_c;
+    size = app_snap_hdr_len_c + keys_len + ((n + 1 + 7) & ~(size_t) 7);
+
+    tmp_path = malloc(strlen(path) + sizeof(".XXXXXX"));
+    if (NULL == tmp_path)
+    {
+        return false;
+    }
+    strcpy(tmp_path, path);
+    strcat(tmp_path, ".XXXXXX");
+
+    fd = mkstemp(tmp_path);
+    if (fd < 0)
+    {
+        free(tmp_path);
+        return false;
+    }
+
+    /* mkstemp() creates the file private, other processes map it too. */
+    map = MAP_FAILED;
+    if ((0 == fchmod(fd, app_snap_mode())) &&
+        (0 == ftruncate(fd, (off_t) size)))
+    {
+        map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+
+    if (MAP_FAILED != map)
+    {
+        /* The file is zero filled, so are index 0 and the padding. */
+        app_snap_eytzinger(list, n, 0, 1,
+                           (uint8_t (*)[ipaddr_len_c])
+                           (map + app_snap_hdr_len_c),
+                           map + app_snap_hdr_len_c + keys_len);
+
+        hdr = (app_snap_hdr_t *) map;
+        memcpy(hdr->magic, app_snap_magic_c, sizeof(app_snap_magic_c));
+        hdr->version = app_snap_version_c;
+        hdr->hdr_len = app_snap_hdr_len_c;
+        hdr->count = n;
+        for (i = 0; i < n; ++i)
+        {
+            hdr->lens[list[i].bits / 8] |= (uint8_t)(1 << (list[i].bits % 8));
+        }
+        hdr->data_sum = app_snap_sum(map + app_snap_hdr_len_c,
+                                     size - app_snap_hdr_len_c);
+        hdr->hdr_sum = app_snap_sum(map, offsetof(app_snap_hdr_t, hdr_sum));
+
+        ret = (0 == munmap(map, size));
+        ret = ret && (0 == fsync(fd));
+    }
+
+    ret = (0 == close(fd)) && ret;
+    ret = ret && (0 == rename(tmp_path, path));
+    if (!ret)
+    {
+        unlink(tmp_path);
+    }
+    /* The rename is only durable once the directory is on disk too. */
+    ret = ret && app_snap_sync_dir(tmp_path);
+
+    free(tmp_path);
+    return ret;
+}
+
+/**
+Map a snapshot file read-only. Nothing is copied, the pages are shared with
+every process mapping the same file and are read in on first use.
+@param[in] path The path of the snapshot file.
+@param[in] verify True to verify the checksum of the whole file, which reads
+in every page, or false to verify the header only.
+@param[out] snap The snapshot.
+@return True on success or false when the file cannot be mapped or is not a
+valid snapshot.
+*/
+bool app_snap_open(const char * path, bool verify, app_snap_t * snap)
+{
+    const app_snap_hdr_t * hdr;
+    struct stat st;
+    size_t keys_len;
+    void * map;
+    bool ret;
+    int fd;
+
+    memset(snap, 0, sizeof(*snap));
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    map = MAP_FAILED;
+    if ((0 == fstat(fd, &st)) && (st.st_size >= app_snap_hdr_len_c))
+    {
+        map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+
+    if (MAP_FAILED == map)
+    {
+        return false;
+    }
+
+    hdr = map;
+    ret = (0 == memcmp(hdr->magic, app_snap_magic_c,
+                       sizeof(app_snap_magic_c))) &&
+          (app_snap_version_c == hdr->version) &&
+          (app_snap_hdr_len_c == hdr->hdr_len) &&
+          (hdr->hdr_sum == app_snap_sum(map,
+                                        offsetof(app_snap_hdr_t, hdr_sum)));
+
+    /* The size check also rejects counts that would overflow. */
+    ret = ret && (hdr->count < (uint64_t) st.st_size / ipaddr_len_c);
+    if (ret)
+    {
+        keys_len = (hdr->count + 1) * ipaddr_len_c;
+        ret = ((size_t) st.st_size == app_snap_hdr_len_c + keys_len +
+               ((hdr->count + 1 + 7) & ~(size_t) 7));
+    }
+    ret = ret && (!verify ||
+                  (hdr->data_sum ==
+                   app_snap_sum((const uint8_t *) map + app_snap_hdr_len_c,
+                                (size_t) st.st_size - app_snap_hdr_len_c)));
+
+    if (!ret)
+    {
+        munmap(map, (size_t) st.st_size);
+        return false;
+    }
+
+    snap->map = map;
+    snap->size = (size_t) st.st_size;
+    snap->hdr = hdr;
+    snap->keys = (const uint8_t (*)[ipaddr_len_c])
+                 (snap->map + app_snap_hdr_len_c);
+    snap->bits = snap->map + app_snap_hdr_len_c + keys_len;
+    snap->n = hdr->count;
+
+    return true;
+}
+
+/**
+Unmap a snapshot.
+@param[in] snap The snapshot.
+*/
+void app_snap_close(app_snap_t * snap)
+{
+    if (NULL != snap->map)
+    {
+        munmap((void *) snap->map, snap->size);
+        snap->map = NULL;
+    }
+}
+
+/**
+Check whether a prefix is in a snapshot.
+@param[in] snap The snapshot.
+@param[in] addr The network number. Host bits are ignored.
+@param[in] bits Length of the prefix in bits.
+@return True when the prefix is in the snapshot or false otherwise.
+*/
+bool app_snap_has_prefix(const app_snap_t * snap, const uint8_t * addr,
+                         uint8_t bits)
+{
+    uint8_t key[ipaddr_len_c];
+
+    if (bits > 128)
+    {
+        return false;
+    }
+
+    memcpy(key, addr, ipaddr_len_c);
+    app_snap_mask(key, bits);
+
+    return app_snap_find(snap, key, bits);
+}
+
+/**
+Find the longest prefix of a snapshot containing an address. Only the prefix
+lengths present in the snapshot are searched, longest first.
+@param[in] snap The snapshot.
+@param[in] addr The address.
+@param[out] bits Length of the longest prefix containing the address.
+@return True when some prefix contains the address or false otherwise.
+*/
+bool app_snap_match(const app_snap_t * snap, const uint8_t * addr,
+                    uint8_t * bits)
+{
+    uint8_t key[ipaddr_len_c];
+    int16_t len;
+
+    memcpy(key, addr, ipaddr_len_c);
+
+    for (len = 128; len >= 0; --len)
+    {
+        if (0 == (snap->hdr->lens[len / 8] & (1 << (len % 8))))
+        {
+            continue;
+        }
+
+        /* Lengths only decrease, so masking the key again is enough. */
+        app_snap_mask(key, (uint8_t) len);
+        if (app_snap_find(snap, key, (uint8_t) len))
+        {
+            *bits = (uint8_t) len;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+Search a network number and prefix length in the Eytzinger layout.
+@param[in] snap The snapshot.
+@param[in] key The network number with host bits cleared.
+@param[in] bits Length of the prefix in bits.
+@return True when found or false otherwise.
+*/
+static bool app_snap_find(const app_snap_t * snap, const uint8_t * key,
+                          uint8_t bits)
+{
+    uint64_t hi = app_snap_load(key);
+    uint64_t lo = app_snap_load(key + 8);
+    uint64_t node_hi;
+    uint64_t node_lo;
+    size_t k = 1;
+
+    while (k <= snap->n)
+    {
+        /* The 4 grandchildren share a cache line. */
+        if (4 * k <= snap->n)
+        {
+            __builtin_prefetch(snap->keys[4 * k]);
+        }
+
+        node_hi = app_snap_load(snap->keys[k]);
+        node_lo = app_snap_load(snap->keys[k] + 8);
+        k = 2 * k + ((node_hi < hi) ||
+                     ((node_hi == hi) && ((node_lo < lo) ||
+                                          ((node_lo == lo) &&
+                                           (snap->bits[k] < bits)))));
+    }
+
+    /* Undo the right turns taken after the last left turn, which leaves the
+    first key not less than the searched one, or 0 when there is none. */
+    k >>= __builtin_ctzll(~(unsigned long long) k) + 1;
+
+    return (0 != k) && (snap->bits[k] == bits) &&
+           (0 == memcmp(snap->keys[k], key, ipaddr_len_c));
+}
+
+/**
+Load 8 bytes of a network number as a number, so numbers compare like the
+bytes do.
+@param[in] data The bytes, the most significant first.
+@return The number.
+*/
+static inline uint64_t app_snap_load(const uint8_t * data)
+{
+    uint64_t val;
+
+    memcpy(&val, data, sizeof(val));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    val = __builtin_bswap64(val);
+#endif
+    return val;
+}
+
+/**
+Store sorted prefixes in Eytzinger order, by an in-order walk of the implicit
+tree.
+@param[in] list The sorted prefixes.
+@param[in] n The number of prefixes.
+@param[in] i Index in list of the next prefix to store.
+@param[in] k Index in the Eytzinger layout of the current node.
+@param[out] keys The network numbers.
+@param[out] bits The prefix lengths.
+@return Index in list of the next prefix to store after the subtree of k.
+*/
+static size_t app_snap_eytzinger(const app_cidr_t * list, size_t n, size_t i,
+                                 size_t k, uint8_t (* keys)[ipaddr_len_c],
+                                 uint8_t * bits)
+{
+    if (k <= n)
+    {
+        i = app_snap_eytzinger(list, n, i, 2 * k, keys, bits);
+        memcpy(keys[k], list[i].addr, ipaddr_len_c);
+        bits[k] = list[i].bits;
+        i = app_snap_eytzinger(list, n, i + 1, 2 * k + 1, keys, bits);
+    }
+
+    return i;
+}
+
+/**
+Calculate the checksum of snapshot data, FNV-1a over 64-bit words.
+@param[in] data The data, 8-byte aligned.
+@param[in] len The length of the data in bytes, a multiple of 8.
+@return The checksum.
+*/
+static uint64_t app_snap_sum(const uint8_t * data, size_t len)
+{
+    const uint64_t * word = (const uint64_t *) data;
+    uint64_t sum = 0xCBF29CE484222325ull;
+    size_t i;
+
+    for (i = 0; i < len / 8; ++i)
+    {
+        sum ^= word[i];
+        sum *= 0x100000001B3ull;
+    }
+
+    return sum;
+}
+
+/**
+Clear the host bits of a network number.
+@param[in,out] addr The network number.
+@param[in] bits Length of the prefix in bits.
+*/
+static void app_snap_mask(uint8_t * addr, uint8_t bits)
+{
+    uint8_t bytes = bits / 8;
+
+    if (bits < 128)
+    {
+        if (0 != (bits % 8))
+        {
+            addr[bytes] &= (uint8_t)(0xff << (8 - (bits % 8)));
+            ++bytes;
+        }
+        memset(addr + bytes, 0, ipaddr_len_c - bytes);
+    }
+}
+
+/**
+Permissions of a new snapshot, those open() gives a file created with 0666.
+umask() can only be read by setting it, so it is set back at once.
+@return The permissions.
+*/
+static mode_t app_snap_mode(void)
+{
+    mode_t mask = umask(0);
+
+    umask(mask);
+    return 0666 & ~mask;
+}
+
+/**
+Flush the directory of a file, so a rename within it survives a crash.
+@param[in,out] path The path of the file, cut to the directory.
+@return True on success or false otherwise.
+*/
+static bool app_snap_sync_dir(char * path)
+{
+    char * slash = strrchr(path, '/');
+    bool ret;
+    int fd;
+
+    if (NULL == slash)
+    {
+        fd = open(".", O_RDONLY | O_DIRECTORY);
+    }
+    else
+    {
+        /* Keep the root's slash, /snap lives in /. */
+        slash[(slash == path) ? 1 : 0] = '\0';
+        fd = open(path, O_RDONLY | O_DIRECTORY);
+    }
+    if (fd < 0)
+    {
+        return false;
+    }
+    ret = (0 == fsync(fd));
+    ret = (0 == close(fd)) && ret;
+
+    return ret;
+}
\ No newline at end of file
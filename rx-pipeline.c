@@ -0,0 +1,946 @@
+#define ipaddr_len_c 16
+/** Size of IPv6 header */
+#define IP_IPH_LEN 40
+/** Types of Next header (Protocols) */
+#define IP_PROTO_UDP 17  /** UDP header */
+#define IP_PROTO_ICMP6 58  /** ICMPv6 header */
+
+/** Size of a cache line in bytes. Shared fields are padded to it. */
+#define app_cache_line_c 64
+/** Maximum number of descriptors moved by one burst. */
+#define app_pipe_burst_c 32
+/** Maximum number of checksum workers of a pipeline. */
+#define app_pipe_max_workers_c 16
+/** Core number meaning "do not pin this stage". */
+#define app_pipe_no_core_c (-1)
+/** Idle polls a stage spins for before it yields its core. */
+#define app_pipe_spin_c 64
+
+/** IP address type. 0 for link local address, 1 for global address and 2 for
+ multicast address. The most significant byte is saved in byte 0. */
+typedef uint8_t ipaddr_t[ipaddr_len_c];
+
+/** The IPv6 header. */
+typedef struct ip_hdr_tag
+{
+    /** Version + Traffic class  */
+    uint8_t vtc;
+    /** Traffic class + Flow label */
+    uint8_t tcflow;
+    /** Flow label 16bits */
+    uint8_t flow[2];
+    /** Length of the IPv6 payload */
+    uint8_t len[2];
+    /** Type of header immediately following the IPv6 header. */
+    uint8_t proto;
+    /** Hop limit - Time to Live*/
+    uint8_t ttl;
+    /** 128-bit address of the originator of the packet. */
+    ipaddr_t srcaddr;
+    /** 128-bit address of the intended recipient of the packet */
+    ipaddr_t dstaddr;
+} ip_hdr_t;
+
+/** Result of the checksum verification stage. */
+typedef enum app_pkt_status_tag
+{
+    /** Not verified yet. */
+    app_pkt_pending_c = 0,
+    /** Upper layer checksum is correct. */
+    app_pkt_ok_c,
+    /** Upper layer checksum is wrong. */
+    app_pkt_bad_chksum_c,
+    /** Payload length does not fit into the received buffer. */
+    app_pkt_malformed_c,
+    /** Upper layer protocol is not verified by the pipeline. */
+    app_pkt_unsupported_c
+} app_pkt_status_t;
+
+/** Packet descriptor carried through the rings. */
+typedef struct app_pkt_desc_tag
+{
+    /** The received packet starting with its IPv6 header. */
+    ip_hdr_t * hdr;
+    /** Number of valid bytes at hdr. */
+    uint16_t len;
+    /** Worker the flow has been hashed to. */
+    uint8_t worker;
+    /** Verification result, see app_pkt_status_t. */
+    uint8_t status;
+    /** Symmetric hash of the source and destination addresses. */
+    uint32_t flow_hash;
+    /** Owner data, untouched by the pipeline. */
+    void * user;
+} app_pkt_desc_t;
+
+/** Lock-free single producer single consumer ring of descriptors. The
+producer and consumer indexes live on separate cache lines, each with a
+private copy of the other side's index so the shared line is only read when
+the ring looks full or empty. */
+typedef struct app_spsc_ring_tag
+{
+    /** Next slot to write, owned by the producer. */
+    _Alignas(app_cache_line_c) _Atomic uint32_t head;
+    /** Producer's last seen value of tail. */
+    uint32_t tail_cache;
+    /** Next slot to read, owned by the consumer. */
+    _Alignas(app_cache_line_c) _Atomic uint32_t tail;
+    /** Consumer's last seen value of head. */
+    uint32_t head_cache;
+    /** Number of slots minus one. The number of slots is a power of 2. */
+    _Alignas(app_cache_line_c) uint32_t mask;
+    /** The slots. */
+    app_pkt_desc_t ** slots;
+} app_spsc_ring_t;
+
+/**
+Packet source of the pipeline, called from the receive stage only.
+@param[in] ctx The source context.
+@param[out] descs The received descriptors.
+@param[in] max The maximum number of descriptors to return.
+@return The number of descriptors received, or -1 at the end of the stream.
+*/
+typedef int32_t (* app_pipe_rx_fn)(void * ctx, app_pkt_desc_t ** descs,
+                                   uint16_t max);
+
+/**
+Return descriptors handed to the consumer back to the packet source.
+It is called from the receive stage while the stage runs and from the
+delivery stage after the receive stage has finished.
+@param[in] ctx The source context.
+@param[in] descs The descriptors released.
+@param[in] n The number of descriptors.
+*/
+typedef void (* app_pipe_free_fn)(void * ctx, app_pkt_desc_t ** descs,
+                                  uint16_t n);
+
+/**
+Consumer of the verified descriptors, called from the delivery stage.
+@param[in] ctx The consumer context.
+@param[in] descs The verified descriptors, status is set.
+@param[in] n The number of descriptors.
+*/
+typedef void (* app_pipe_deliver_fn)(void * ctx, app_pkt_desc_t ** descs,
+                                     uint16_t n);
+
+/** Pipeline configuration. */
+typedef struct app_pipe_cfg_tag
+{
+    /** Number of checksum workers in [1, app_pipe_max_workers_c]. */
+    uint8_t workers;
+    /** Number of slots of every ring, a power of 2. */
+    uint32_t ring_size;
+    /** Core of the receive stage or app_pipe_no_core_c. */
+    int32_t rx_core;
+    /** Cores of the workers or app_pipe_no_core_c. */
+    int32_t worker_cores[app_pipe_max_workers_c];
+    /** Core of the delivery stage or app_pipe_no_core_c. */
+    int32_t deliver_core;
+    app_pipe_rx_fn rx;
+    app_pipe_free_fn release;
+    void * rx_ctx;
+    app_pipe_deliver_fn deliver;
+    void * deliver_ctx;
+} app_pipe_cfg_t;
+
+/** Per worker state. */
+typedef struct app_pipe_worker_tag
+{
+    /** Receive stage to worker. */
+    app_spsc_ring_t in;
+    /** Worker to delivery stage. */
+    app_spsc_ring_t out;
+    /** Back pointer to the pipeline. */
+    struct app_pipe_tag * pipe;
+    /** Index of the worker. */
+    uint8_t index;
+    /** Set by the worker when it has drained its input for good. */
+    _Atomic bool done;
+    pthread_t thread;
+} app_pipe_worker_t;
+
+/** The pipeline: receive -> hash to worker -> verify checksum -> deliver. */
+typedef struct app_pipe_tag
+{
+    app_pipe_cfg_t cfg;
+    app_pipe_worker_t workers[app_pipe_max_workers_c];
+    /** Delivery stage to receive stage, for descriptors to be released. */
+    app_spsc_ring_t recycle;
+    /** Cleared to ask the receive stage to stop early. */
+    _Atomic bool running;
+    /** Set by the receive stage when it stops producing. */
+    _Atomic bool rx_done;
+    pthread_t rx_thread;
+    pthread_t deliver_thread;
+} app_pipe_t;
+
+/** Synthetic packet generator, usable as the pipeline source. */
+typedef struct app_pktgen_tag
+{
+    /** Packet buffers, one per descriptor. */
+    uint8_t * buf;
+    /** The descriptors. */
+    app_pkt_desc_t * descs;
+    /** Free descriptors, a stack. */
+    app_pkt_desc_t ** free;
+    uint32_t free_cnt;
+    /** Number of descriptors and buffers. */
+    uint32_t pool;
+    /** Size of every packet buffer in bytes. */
+    uint16_t pkt_len;
+    /** Number of packets still to be generated. */
+    uint64_t remain;
+} app_pktgen_t;
+
+/**
+Initialize a ring.
+@param[out] ring The ring to initialize.
+@param[in] size The number of slots, which must be a power of 2.
+@return True when the ring is ready or false otherwise.
+*/
+bool app_ring_init(app_spsc_ring_t * ring, uint32_t size)
+{
+    bool ret = false;
+
+    if ((size >= 2) && (0 == (size & (size - 1))))
+    {
+        atomic_init(&ring->head, 0);
+        atomic_init(&ring->tail, 0);
+        ring->tail_cache = 0;
+        ring->head_cache = 0;
+        ring->mask = size - 1;
+        ring->slots = calloc(size, sizeof(app_pkt_desc_t *));
+        ret = (NULL != ring->slots);
+    }
+
+    return ret;
+}
+
+/**
+Release the memory of a ring.
+@param[in] ring The ring.
+*/
+void app_ring_free(app_spsc_ring_t * ring)
+{
+    free(ring->slots);
+    ring->slots = NULL;
+}
+
+/**
+Add descriptors to a ring. Only one thread may enqueue to a ring.
+@param[in] ring The ring.
+@param[in] descs The descriptors to add.
+@param[in] n The number of descriptors.
+@return The number of descriptors added, which is less than n when the ring
+is full.
+*/
+uint16_t app_ring_enqueue_burst(app_spsc_ring_t * ring,
+                                app_pkt_desc_t ** descs, uint16_t n)
+{
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t room = ring->mask + 1 - (head - ring->tail_cache);
+    uint16_t i;
+
+    if (room < n)
+    {
+        ring->tail_cache = atomic_load_explicit(&ring->tail,
+                                                memory_order_acquire);
+        room = ring->mask + 1 - (head - ring->tail_cache);
+        if (room < n)
+        {
+            n = room;
+        }
+    }
+
+    for (i = 0; i < n; ++i)
+    {
+        ring->slots[(head + i) & ring->mask] = descs[i];
+    }
+    atomic_store_explicit(&ring->head, head + n, memory_order_release);
+
+    return n;
+}
+
+/**
+Take descriptors from a ring. Only one thread may dequeue from a ring.
+@param[in] ring The ring.
+@param[out] descs The descriptors taken.
+@param[in] n The maximum number of descriptors to take.
+@return The number of descriptors taken.
+*/
+uint16_t app_ring_dequeue_burst(app_spsc_ring_t * ring,
+                                app_pkt_desc_t ** descs, uint16_t n)
+{
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t avail = ring->head_cache - tail;
+    uint16_t i;
+
+    if (avail < n)
+    {
+        ring->head_cache = atomic_load_explicit(&ring->head,
+                                                memory_order_acquire);
+        avail = ring->head_cache - tail;
+        if (avail < n)
+        {
+            n = avail;
+        }
+    }
+
+    for (i = 0; i < n; ++i)
+    {
+        descs[i] = ring->slots[(tail + i) & ring->mask];
+    }
+    atomic_store_explicit(&ring->tail, tail + n, memory_order_release);
+
+    return n;
+}
+
+/**
+Start a pipeline. Every stage runs on its own thread, pinned to its core.
+@param[out] pipe The pipeline.
+@param[in] cfg The configuration, copied into the pipeline.
+@return True when all stages are running or false otherwise, e.g. when a core
+cannot be used. Nothing is left running on failure.
+*/
+bool app_pipe_start(app_pipe_t * pipe, const app_pipe_cfg_t * cfg)
+{
+    uint8_t i;
+    uint8_t ready = 0;
+    uint8_t started = 0;
+    bool deliver = false;
+    bool ret = false;
+
+    memset(pipe, 0, sizeof(*pipe));
+    pipe->cfg = *cfg;
+    if ((cfg->workers == 0) || (cfg->workers > app_pipe_max_workers_c))
+    {
+        return false;
+    }
+
+    if (app_ring_init(&pipe->recycle, cfg->ring_size))
+    {
+        for (ready = 0; ready < cfg->workers; ++ready)
+        {
+            app_pipe_worker_t * w = &pipe->workers[ready];
+            if (!app_ring_init(&w->in, cfg->ring_size))
+            {
+                break;
+            }
+            if (!app_ring_init(&w->out, cfg->ring_size))
+            {
+                app_ring_free(&w->in);
+                break;
+            }
+            w->pipe = pipe;
+            w->index = ready;
+            atomic_init(&w->done, false);
+        }
+    }
+
+    if (ready == cfg->workers)
+    {
+        atomic_init(&pipe->running, true);
+        atomic_init(&pipe->rx_done, false);
+        for (started = 0; started < cfg->workers; ++started)
+        {
+            if (!app_pipe_create(&pipe->workers[started].thread,
+                                 cfg->worker_cores[started],
+                                 app_pipe_worker_main,
+                                 &pipe->workers[started]))
+            {
+                break;
+            }
+        }
+        deliver = (started == cfg->workers) &&
+                  app_pipe_create(&pipe->deliver_thread, cfg->deliver_core,
+                                  app_pipe_deliver_main, pipe);
+        ret = deliver &&
+              app_pipe_create(&pipe->rx_thread, cfg->rx_core,
+                              app_pipe_rx_main, pipe);
+        if (!ret)
+        {
+            app_pipe_abort(pipe, started, deliver);
+        }
+    }
+
+    if (!ret)
+    {
+        for (i = 0; i < ready; ++i)
+        {
+            app_ring_free(&pipe->workers[i].in);
+            app_ring_free(&pipe->workers[i].out);
+        }
+        app_ring_free(&pipe->recycle);
+    }
+
+    return ret;
+}
+
+/**
+Wait for a pipeline to drain and release its resources. The pipeline stops
+when the source reports the end of its stream or after app_pipe_stop().
+@param[in] pipe The pipeline.
+*/
+void app_pipe_join(app_pipe_t * pipe)
+{
+    app_pkt_desc_t * burst[app_pipe_burst_c];
+    uint16_t n;
+    uint8_t i;
+
+    pthread_join(pipe->rx_thread, NULL);
+    for (i = 0; i < pipe->cfg.workers; ++i)
+    {
+        pthread_join(pipe->workers[i].thread, NULL);
+    }
+    pthread_join(pipe->deliver_thread, NULL);
+
+    while ((n = app_ring_dequeue_burst(&pipe->recycle, burst,
+                                       app_pipe_burst_c)) > 0)
+    {
+        pipe->cfg.release(pipe->cfg.rx_ctx, burst, n);
+    }
+
+    for (i = 0; i < pipe->cfg.workers; ++i)
+    {
+        app_ring_free(&pipe->workers[i].in);
+        app_ring_free(&pipe->workers[i].out);
+    }
+    app_ring_free(&pipe->recycle);
+}
+
+/**
+Ask the receive stage to stop. Descriptors already received are still
+verified and delivered.
+@param[in] pipe The pipeline.
+*/
+void app_pipe_stop(app_pipe_t * pipe)
+{
+    atomic_store_explicit(&pipe->running, false, memory_order_relaxed);
+}
+
+/**
+Hash the addresses of a packet. The hash is symmetric so both directions of
+a flow go to the same worker.
+@param[in] hdr The ip header of the packet.
+@return The hash value.
+*/
+uint32_t app_pipe_flow_hash(const ip_hdr_t * hdr)
+{
+    uint64_t lo;
+    uint64_t hi;
+    uint64_t t;
+
+    memcpy(&lo, hdr->srcaddr, 8);
+    memcpy(&hi, hdr->srcaddr + 8, 8);
+    memcpy(&t, hdr->dstaddr, 8);
+    lo ^= t;
+    memcpy(&t, hdr->dstaddr + 8, 8);
+    hi ^= t;
+
+    t = (lo ^ (hi * 0x9E3779B97F4A7C15ull)) * 0xC2B2AE3D27D4EB4Full;
+    return (uint32_t) (t >> 32);
+}
+
+/**
+Verify the upper layer checksum of a packet according to rfc 2460 section
+8.1. Unlike calc_upper_layer_chksum() the checksum field is summed in place,
+so a correct packet sums to 0xffff and the packet is not modified.
+@param[in] desc The descriptor of the packet.
+@return The verification result.
+*/
+app_pkt_status_t app_pipe_verify(const app_pkt_desc_t * desc)
+{
+    const ip_hdr_t * hdr = desc->hdr;
+    uint16_t upper_layer_len;
+    uint16_t sum;
+    app_pkt_status_t status;
+
+    upper_layer_len = ((hdr->len[0]) << 8) + hdr->len[1];
+
+    if ((desc->len < IP_IPH_LEN) ||
+        (upper_layer_len > desc->len - IP_IPH_LEN))
+    {
+        status = app_pkt_malformed_c;
+    }
+    else if ((hdr->proto != IP_PROTO_UDP) && (hdr->proto != IP_PROTO_ICMP6))
+    {
+        status = app_pkt_unsupported_c;
+    }
+    else
+    {
+        sum = upper_layer_len + hdr->proto;
+        sum = calc_sum(sum, hdr->srcaddr, 2 * ipaddr_len_c);
+        sum = calc_sum(sum, (const uint8_t *)hdr + IP_IPH_LEN,
+                       upper_layer_len);
+        status = (0xffff == sum) ? app_pkt_ok_c : app_pkt_bad_chksum_c;
+    }
+
+    return status;
+}
+
+/**
+Create a generator of valid UDP packets spread over a number of flows.
+@param[out] gen The generator.
+@param[in] pool Number of packets in flight, at least the ring size times
+the number of workers to keep all stages busy.
+@param[in] payload Size of the UDP payload in bytes.
+@param[in] flows Number of different address pairs.
+@param[in] count Number of packets to generate before the end of stream.
+@return True on success or false otherwise.
+*/
+bool app_pktgen_init(app_pktgen_t * gen, uint32_t pool, uint16_t payload,
+                     uint32_t flows, uint64_t count)
+{
+    uint32_t i;
+    uint32_t j;
+    uint16_t udp_len = 8 + payload;
+    uint16_t chksum;
+    uint8_t * pkt;
+    ip_hdr_t * hdr;
+
+    if ((pool == 0) || (flows == 0) || (payload > 0xffff - IP_IPH_LEN - 8))
+    {
+        return false;
+    }
+
+    gen->pool = pool;
+    gen->pkt_len = IP_IPH_LEN + udp_len;
+    gen->remain = count;
+    gen->buf = aligned_alloc(app_cache_line_c,
+                             (size_t) pool *
+                             ((gen->pkt_len + app_cache_line_c - 1) &
+                              ~(app_cache_line_c - 1)));
+    gen->descs = calloc(pool, sizeof(app_pkt_desc_t));
+    gen->free = calloc(pool, sizeof(app_pkt_desc_t *));
+    if ((NULL == gen->buf) || (NULL == gen->descs) || (NULL == gen->free))
+    {
+        app_pktgen_free(gen);
+        return false;
+    }
+
+    for (i = 0; i < pool; ++i)
+    {
+        pkt = gen->buf + (size_t) i *
+              ((gen->pkt_len + app_cache_line_c - 1) &
+               ~(app_cache_line_c - 1));
+        memset(pkt, 0, gen->pkt_len);
+        hdr = (ip_hdr_t *) pkt;
+        hdr->vtc = 0x60;
+        hdr->len[0] = (uint8_t) (udp_len >> 8);
+        hdr->len[1] = (uint8_t) udp_len;
+        hdr->proto = IP_PROTO_UDP;
+        hdr->ttl = 64;
+        /* 2001:db8::/32 documentation prefix, flow number in the host part. */
+        hdr->srcaddr[0] = 0x20;
+        hdr->srcaddr[1] = 0x01;
+        hdr->srcaddr[2] = 0x0d;
+        hdr->srcaddr[3] = 0xb8;
+        memcpy(hdr->dstaddr, hdr->srcaddr, ipaddr_len_c);
+        hdr->srcaddr[12] = (uint8_t) ((i % flows) >> 24);
+        hdr->srcaddr[13] = (uint8_t) ((i % flows) >> 16);
+        hdr->srcaddr[14] = (uint8_t) ((i % flows) >> 8);
+        hdr->srcaddr[15] = (uint8_t) (i % flows);
+        hdr->dstaddr[15] = 1;
+
+        pkt[IP_IPH_LEN + 0] = 0xc0;
+        pkt[IP_IPH_LEN + 1] = 0x00;
+        pkt[IP_IPH_LEN + 2] = 0x00;
+        pkt[IP_IPH_LEN + 3] = 0x35;
+        pkt[IP_IPH_LEN + 4] = (uint8_t) (udp_len >> 8);
+        pkt[IP_IPH_LEN + 5] = (uint8_t) udp_len;
+        for (j = 0; j < payload; ++j)
+        {
+            pkt[IP_IPH_LEN + 8 + j] = (uint8_t) (i + j);
+        }
+        chksum = calc_udp_chksum(hdr);
+        pkt[IP_IPH_LEN + 6] = (uint8_t) (chksum >> 8);
+        pkt[IP_IPH_LEN + 7] = (uint8_t) chksum;
+
+        gen->descs[i].hdr = hdr;
+        gen->descs[i].len = gen->pkt_len;
+        gen->free[i] = &gen->descs[i];
+    }
+    gen->free_cnt = pool;
+
+    return true;
+}
+
+/**
+Release the memory of a generator.
+@param[in] gen The generator.
+*/
+void app_pktgen_free(app_pktgen_t * gen)
+{
+    free(gen->buf);
+    free(gen->descs);
+    free(gen->free);
+    gen->buf = NULL;
+    gen->descs = NULL;
+    gen->free = NULL;
+}
+
+/**
+Pipeline source of a generator, see app_pipe_rx_fn.
+*/
+int32_t app_pktgen_rx(void * ctx, app_pkt_desc_t ** descs, uint16_t max)
+{
+    app_pktgen_t * gen = ctx;
+    uint16_t n = 0;
+
+    if (0 == gen->remain)
+    {
+        return -1;
+    }
+
+    if (max > gen->remain)
+    {
+        max = (uint16_t) gen->remain;
+    }
+    while ((n < max) && (gen->free_cnt > 0))
+    {
+        --gen->free_cnt;
+        descs[n] = gen->free[gen->free_cnt];
+        descs[n]->status = app_pkt_pending_c;
+        ++n;
+    }
+    gen->remain -= n;
+
+    return n;
+}
+
+/**
+Pipeline release function of a generator, see app_pipe_free_fn.
+*/
+void app_pktgen_release(void * ctx, app_pkt_desc_t ** descs, uint16_t n)
+{
+    app_pktgen_t * gen = ctx;
+    uint16_t i;
+
+    for (i = 0; i < n; ++i)
+    {
+        gen->free[gen->free_cnt] = descs[i];
+        ++gen->free_cnt;
+    }
+}
+
+/**
+Start the thread of a stage, pinned to its core. The affinity is set before
+the thread runs, so a core that does not exist or is not allowed fails here
+rather than leaving the stage unpinned.
+@param[out] thread The thread.
+@param[in] core The core number or app_pipe_no_core_c.
+@param[in] stage The stage.
+@param[in] arg The argument of the stage.
+@return True when the thread is running or false otherwise.
+*/
+static bool app_pipe_create(pthread_t * thread, int32_t core,
+                            void * (* stage)(void *), void * arg)
+{
+    pthread_attr_t attr;
+    cpu_set_t set;
+    bool ret = false;
+
+    if (core == app_pipe_no_core_c)
+    {
+        return 0 == pthread_create(thread, NULL, stage, arg);
+    }
+    if ((core < 0) || (core >= CPU_SETSIZE) || (0 != pthread_attr_init(&attr)))
+    {
+        return false;
+    }
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    ret = (0 == pthread_attr_setaffinity_np(&attr, sizeof(set), &set)) &&
+          (0 == pthread_create(thread, &attr, stage, arg));
+    pthread_attr_destroy(&attr);
+
+    return ret;
+}
+
+/**
+Wait a little after a poll that found no work or no room. A stage spins with
+a pause hint for app_pipe_spin_c polls, then yields its core on every poll, so
+unpinned stages sharing a core let each other run.
+@param[in,out] idle Number of idle polls in a row, reset by the caller when
+the stage makes progress.
+*/
+static void app_pipe_backoff(uint32_t * idle)
+{
+    if (*idle < app_pipe_spin_c)
+    {
+        ++*idle;
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+    else
+    {
+        sched_yield();
+    }
+}
+
+/**
+Stop the stages started so far when a pipeline fails to start. The receive
+stage is started last, so the rings are still empty and the stages exit as
+soon as they see the end of the stream.
+@param[in] pipe The pipeline.
+@param[in] started The number of worker threads started.
+@param[in] deliver True when the delivery thread was started.
+*/
+static void app_pipe_abort(app_pipe_t * pipe, uint8_t started, bool deliver)
+{
+    uint8_t i;
+
+    atomic_store_explicit(&pipe->running, false, memory_order_relaxed);
+    atomic_store_explicit(&pipe->rx_done, true, memory_order_release);
+
+    /* The delivery stage waits for every worker, started or not. */
+    for (i = started; i < pipe->cfg.workers; ++i)
+    {
+        atomic_store_explicit(&pipe->workers[i].done, true,
+                              memory_order_release);
+    }
+
+    for (i = 0; i < started; ++i)
+    {
+        pthread_join(pipe->workers[i].thread, NULL);
+    }
+    if (deliver)
+    {
+        pthread_join(pipe->deliver_thread, NULL);
+    }
+}
+
+/**
+Receive stage. Polls the source, hashes every packet to a worker and returns
+the descriptors released by the delivery stage to the source.
+@param[in] arg The pipeline.
+*/
+static void * app_pipe_rx_main(void * arg)
+{
+    app_pipe_t * pipe = arg;
+    const app_pipe_cfg_t * cfg = &pipe->cfg;
+    app_pkt_desc_t * burst[app_pipe_burst_c];
+    app_pkt_desc_t * per_worker[app_pipe_max_workers_c][app_pipe_burst_c];
+    uint16_t cnt[app_pipe_max_workers_c];
+    uint16_t sent;
+    uint16_t n;
+    int32_t got = 0;
+    uint32_t idle = 0;
+    uint8_t w;
+    uint16_t i;
+
+    while ((got >= 0) &&
+           atomic_load_explicit(&pipe->running, memory_order_relaxed))
+    {
+        n = app_ring_dequeue_burst(&pipe->recycle, burst, app_pipe_burst_c);
+        if (n > 0)
+        {
+            cfg->release(cfg->rx_ctx, burst, n);
+        }
+
+        got = cfg->rx(cfg->rx_ctx, burst, app_pipe_burst_c);
+        if (got <= 0)
+        {
+            if (got == 0)
+            {
+                app_pipe_backoff(&idle);
+            }
+            continue;
+        }
+        idle = 0;
+
+        memset(cnt, 0, sizeof(cnt));
+        for (i = 0; i < got; ++i)
+        {
+            burst[i]->flow_hash = app_pipe_flow_hash(burst[i]->hdr);
+            w = (uint8_t) (((uint64_t) burst[i]->flow_hash * cfg->workers)
+                           >> 32);
+            burst[i]->worker = w;
+            per_worker[w][cnt[w]] = burst[i];
+            ++cnt[w];
+        }
+
+        for (w = 0; w < cfg->workers; ++w)
+        {
+            sent = app_ring_enqueue_burst(&pipe->workers[w].in,
+                                          per_worker[w], cnt[w]);
+            while (sent < cnt[w])
+            {
+                /* Keep the recycle ring moving, the delivery stage may be
+                waiting on it while the worker waits on the delivery stage. */
+                n = app_ring_dequeue_burst(&pipe->recycle, burst,
+                                           app_pipe_burst_c);
+                if (n > 0)
+                {
+                    cfg->release(cfg->rx_ctx, burst, n);
+                }
+                sent += app_ring_enqueue_burst(&pipe->workers[w].in,
+                                               per_worker[w] + sent,
+                                               cnt[w] - sent);
+                app_pipe_backoff(&idle);
+            }
+            idle = 0;
+        }
+    }
+
+    atomic_store_explicit(&pipe->rx_done, true, memory_order_release);
+    return NULL;
+}
+
+/**
+Checksum verification stage of one worker.
+@param[in] arg The worker.
+*/
+static void * app_pipe_worker_main(void * arg)
+{
+    app_pipe_worker_t * w = arg;
+    app_pipe_t * pipe = w->pipe;
+    app_pkt_desc_t * burst[app_pipe_burst_c];
+    uint16_t sent;
+    uint16_t n;
+    uint16_t i;
+    uint32_t idle = 0;
+    bool last = false;
+
+    for (;;)
+    {
+        /* Producer finished before this poll: whatever is left is all. */
+        last = atomic_load_explicit(&pipe->rx_done, memory_order_acquire);
+        n = app_ring_dequeue_burst(&w->in, burst, app_pipe_burst_c);
+        if (n == 0)
+        {
+            if (last)
+            {
+                break;
+            }
+            app_pipe_backoff(&idle);
+            continue;
+        }
+        idle = 0;
+
+        for (i = 0; i < n; ++i)
+        {
+            burst[i]->status = app_pipe_verify(burst[i]);
+        }
+
+        sent = app_ring_enqueue_burst(&w->out, burst, n);
+        while (sent < n)
+        {
+            app_pipe_backoff(&idle);
+            sent += app_ring_enqueue_burst(&w->out, burst + sent, n - sent);
+        }
+        idle = 0;
+    }
+
+    atomic_store_explicit(&w->done, true, memory_order_release);
+    return NULL;
+}
+
+/**
+Delivery stage. Hands verified bursts to the consumer and sends the
+descriptors back for release.
+@param[in] arg The pipeline.
+*/
+static void * app_pipe_deliver_main(void * arg)
+{
+    app_pipe_t * pipe = arg;
+    const app_pipe_cfg_t * cfg = &pipe->cfg;
+    app_pkt_desc_t * burst[app_pipe_burst_c];
+    uint16_t sent;
+    uint16_t n;
+    uint32_t idle = 0;
+    uint8_t w;
+    uint8_t finished;
+    bool moved;
+    bool done;
+
+    do
+    {
+        finished = 0;
+        moved = false;
+        for (w = 0; w < cfg->workers; ++w)
+        {
+            done = atomic_load_explicit(&pipe->workers[w].done,
+                                        memory_order_acquire);
+            n = app_ring_dequeue_burst(&pipe->workers[w].out, burst,
+                                       app_pipe_burst_c);
+            if (n == 0)
+            {
+                finished += done;
+                continue;
+            }
+
+            moved = true;
+            cfg->deliver(cfg->deliver_ctx, burst, n);
+
+            sent = 0;
+            while (sent < n)
+            {
+                if (atomic_load_explicit(&pipe->rx_done, memory_order_acquire))
+                {
+                    /* Nobody drains the recycle ring any more. */
+                    cfg->release(cfg->rx_ctx, burst + sent, n - sent);
+                    break;
+                }
+                sent += app_ring_enqueue_burst(&pipe->recycle, burst + sent,
+                                               n - sent);
+                if (sent < n)
+                {
+                    app_pipe_backoff(&idle);
+                }
+            }
+        }
+
+        if (moved)
+        {
+            idle = 0;
+        }
+        else
+        {
+            app_pipe_backoff(&idle);
+        }
+    } while (finished < cfg->workers);
+
+    return NULL;
+}
+
+/**
+Calculate sum of a series of data.
+@param[in] sum The separated number to be added in the calculation.
+@param[in] data The pointer to the data.
+@param[in] len The length of the data in bytes.
+@return The checksum in host byte order.
+*/
+static uint16_t calc_sum(uint16_t sum, const uint8_t *data, uint16_t len)
+{
+    uint16_t t;
+    const uint8_t *dataptr;
+    const uint8_t *last_byte;
+
+    dataptr = data;
+    last_byte = data + len - 1;
+
+    while(dataptr < last_byte)
+    {
+        /* At least two more bytes */
+        t = (dataptr[0] << 8) + dataptr[1];
+        sum += t;
+        if (sum < t)
+        {
+            ++sum; /* Carry */
+        }
+        dataptr += 2;
+    }
+
+    if (dataptr == last_byte)
+    {
+        t = (dataptr[0] << 8) + 0;
+        sum += t;
+        if (sum < t)
+        {
+            ++sum; /* carry */
+        }
+    }
+    return sum;
+}
\ No newline at end of file
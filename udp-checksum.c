@@ -1,3 +1,5 @@
+#include "app-instrument.h"
+
 #define ipaddr_len_c 16
 /** Size of IPv6 header */
 #define IP_IPH_LEN 40
@@ -46,6 +48,7 @@ static uint16_t calc_upper_layer_chksum(ip_hdr_t * hdr, uint8_t proto)
     uint16_t sum = 0;
     uint16_t upper_layer_len;
     uint8_t * ptr = (uint8_t *)hdr;
+    APP_INSTR_BEGIN();
 
     upper_layer_len = ((hdr->len[0]) << 8) + hdr->len[1];
 
@@ -56,6 +59,8 @@ static uint16_t calc_upper_layer_chksum(ip_hdr_t * hdr, uint8_t proto)
     /* Sum upper layer header and data. */
     sum = calc_sum(sum, (uint8_t *)(ptr + IP_IPH_LEN), upper_layer_len);
 
+    APP_INSTR_END(app_instr_upper_layer_chksum_c,
+                  2 * ipaddr_len_c + upper_layer_len);
     return(0xffff - sum);
 }
 